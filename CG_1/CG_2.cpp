@@ -1,29 +1,18 @@
-﻿#include <iostream>
-#include <vector>
-#include <string>
-#include <memory>
-#include <ctime>
-#include <cmath>
-#include <iomanip>
-
-#define GLEW_STATIC 
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-#include <glm/glm.hpp>
-
-#ifndef M_PI
-#define M_PI 3.14159265358979323846 // Определение константы PI, если она отсутствует.
-#endif
+﻿#include "app.h"
+#include "benchmarks.h"
 
 // Вершинный шейдер для гладкого (интерполированного) закрашивания.
+// position_scale и position_offset восстанавливают сжатые позиции (VertexLayout::HalfRGBA8 и др.), для остальных моделей не меняются.
 const char* VERTEX_SHADER_SMOOTH = R"glsl(
     #version 400
     in vec3 vertex_position;
     in vec3 vertex_color;
+    uniform vec3 position_scale = vec3(1.0);
+    uniform vec3 position_offset = vec3(0.0);
     out vec3 color;
     void main() {
         color = vertex_color;
-        gl_Position = vec4(vertex_position, 1.0);
+        gl_Position = vec4(vertex_position * position_scale + position_offset, 1.0);
     }
 )glsl";
 
@@ -42,10 +31,12 @@ const char* VERTEX_SHADER_FLAT = R"glsl(
     #version 400
     in vec3 vertex_position;
     in vec3 vertex_color;
+    uniform vec3 position_scale = vec3(1.0);
+    uniform vec3 position_offset = vec3(0.0);
     flat out vec3 color;
     void main() {
         color = vertex_color;
-        gl_Position = vec4(vertex_position, 1.0);
+        gl_Position = vec4(vertex_position * position_scale + position_offset, 1.0);
     }
 )glsl";
 
@@ -59,264 +50,393 @@ const char* FRAGMENT_SHADER_FLAT = R"glsl(
     }
 )glsl";
 
-// Перечисление для режимов отрисовки в 5-м задании.
-enum class Task5Mode {Triangles=1, Strip, Fan };
-// Перечисление для режимов отображения граней в 8-м задании.
-enum class Task8Mode { Vertices = 1, FillFrontLineBack, Wireframe };
-// Перечисление для выбора типа тонирования (закрашивания).
-enum class ToningMode { Flat = 1, Smooth };
-
-// Класс для управления геометрией объекта (вершины, цвета, индексы).
-class Model {
-private:
-    GLuint vao = 0; // ID объекта вершинного массива (Vertex Array Object).
-    size_t verteces_count = 0; // Количество вершин модели.
-    size_t indices_count = 0; // Количество индексов модели.
-    GLuint shaderProgramID = 0; // ID используемой шейдерной программы.
-public:
-    Model() { glGenVertexArrays(1, &vao); } // Конструктор: создает VAO для модели.
-    ~Model() { glDeleteVertexArrays(1, &vao); } // Деструктор: освобождает память VAO при удалении модели.
-    void render(GLuint mode) { // Главная функция отрисовки модели с заданным режимом.
-        glUseProgram(shaderProgramID); // Активируем шейдер.
-        glBindVertexArray(vao); // Привязываем VAO модели.
-        if (indices_count > 0) glDrawElements(mode, (GLsizei)indices_count, GL_UNSIGNED_INT, 0); // Рисуем по индексам, если они есть.
-        else glDrawArrays(mode, 0, (GLsizei)verteces_count); // Иначе рисуем по вершинам напрямую.
-    }
-    void load_coords(const std::vector<glm::vec3>& vertices) { // Загрузка координат вершин в видеопамять (VBO).
-        verteces_count = vertices.size();
-        GLuint vbo; glGenBuffers(1, &vbo);
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-        glEnableVertexAttribArray(0);
-    }
-    void load_colors(const std::vector<glm::vec3>& colors) { // Загрузка цветов вершин в видеопамять (VBO).
-        GLuint vbo; glGenBuffers(1, &vbo);
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec3), colors.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-        glEnableVertexAttribArray(1);
-    }
-    void load_indices(const std::vector<GLuint>& indices) { // Загрузка индексов вершин для оптимизированной отрисовки (EBO).
-        indices_count = indices.size();
-        GLuint ebo; glGenBuffers(1, &ebo);
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-    }
-    void setShaderProgram(GLuint programID) { shaderProgramID = programID; } // Установка шейдерной программы для использования этой моделью.
-};
-
-// Структура, хранящая все состояние приложения
-struct AppState {
-    int winWidth = 800, winHeight = 800;
-    int currentTask = 1;
-    float pointSmoothSize = 20.0f;
-    float lineWidth = 4.0f;
-    int lastPrintedPointSize = 0; 
-    int lastPrintedLineWidth = 0; 
-    float keyHoldTimeUp = 0.0f;     
-    float keyHoldTimeDown = 0.0f;
-    Task5Mode task5Mode = Task5Mode::Triangles;
-    Task8Mode task8Mode = Task8Mode::Vertices;
-    ToningMode toningMode = ToningMode::Flat;
-    Model* task4And5_triangles = nullptr, * task4And5_strip = nullptr; 
-    Model* task4And5_fan1 = nullptr, * task4And5_fan2 = nullptr;
-    Model* task7And8_flat = nullptr, * task7And8_smooth = nullptr;
-    GLuint smoothShaderProgram = 0, flatShaderProgram = 0; // ID скомпилированных шейдерных программ.    
-};
+// Вершинный шейдер для инстансинга: каждый экземпляр сдвигается, масштабируется и окрашивается
+// своими атрибутами (InstanceData), фрагментный шейдер используется от гладкого закрашивания.
+const char* VERTEX_SHADER_INSTANCED = R"glsl(
+    #version 400
+    in vec3 vertex_position;
+    in vec3 vertex_color;
+    in vec3 instance_offset;
+    in float instance_scale;
+    in vec3 instance_color;
+    uniform vec3 position_scale = vec3(1.0);
+    uniform vec3 position_offset = vec3(0.0);
+    out vec3 color;
+    void main() {
+        color = vertex_color * instance_color;
+        vec3 position = vertex_position * position_scale + position_offset;
+        gl_Position = vec4(position * instance_scale + instance_offset, 1.0);
+    }
+)glsl";
+
+// Фрагментный шейдер сглаженных точек (точечные спрайты, вершинный шейдер - VERTEX_SHADER_SMOOTH) вместо GL_POINT_SMOOTH.
+// Покрытие пикселя считается аналитически по расстоянию от центра точки в пикселях и идет в альфу,
+// поэтому проходу с этой программой нужно смешивание (DrawState::blend). Размер point_size задает GLBackend.
+const char* FRAGMENT_SHADER_POINT_SPRITE = R"glsl(
+    #version 400
+    in vec3 color;
+    uniform float point_size = 1.0;
+    out vec4 frag_color;
+    void main() {
+        float r = length(gl_PointCoord - vec2(0.5)) * point_size;
+        float coverage = clamp(0.5 * point_size - r + 0.5, 0.0, 1.0);
+        if (coverage <= 0.0) discard;
+        frag_color = vec4(color, coverage);
+    }
+)glsl";
+
+// Вершинный шейдер толстых линий (ThickPolyline): экземпляр - отрезок a-b, вершины 0..3 - углы четырехугольника
+// (0, 1 - у точки a, 2, 3 - у точки b, четные справа от направления отрезка). Построение идет в пикселях.
+// При соединении "митра" угол сдвигается по биссектрисе между нормалями соседних отрезков, поэтому смежные
+// отрезки сходятся в одной точке без зазора (длина ограничена miter_limit толщин). При скруглении четырехугольник
+// продлевается на полтолщины за концы, а лишнее отсекает фрагментный шейдер по расстоянию до отрезка.
+const char* VERTEX_SHADER_THICK_LINE = R"glsl(
+    #version 400
+    in vec3 point_prev;
+    in vec3 point_a;
+    in vec3 point_b;
+    in vec3 point_next;
+    in vec3 color_a;
+    in vec3 color_b;
+    uniform vec2 viewport_size = vec2(800.0);
+    uniform float line_width = 1.0;
+    uniform bool line_round = false;
+    const float miter_limit = 4.0;
+    out vec3 color;
+    out vec2 segment_coord; // Положение в пикселях: вдоль отрезка от точки a и поперек от его оси.
+    flat out float segment_length;
+    void main() {
+        bool atB = gl_VertexID >= 2;
+        float side = (gl_VertexID & 1) == 0 ? -1.0 : 1.0;
+        vec2 half_size = viewport_size * 0.5;
+        vec2 a = point_a.xy * half_size, b = point_b.xy * half_size;
+        vec2 dir = b - a;
+        float len = length(dir);
+        dir = len > 0.0 ? dir / len : vec2(1.0, 0.0);
+        vec2 normal = vec2(-dir.y, dir.x);
+        float half_width = line_width * 0.5;
+        vec2 p = atB ? b : a, offset;
+        if (line_round) {
+            offset = normal * side * half_width + dir * (atB ? half_width : -half_width);
+        }
+        else {
+            vec2 other = atB ? point_next.xy * half_size - b : a - point_prev.xy * half_size; // Направление соседнего отрезка.
+            vec2 miter = normal;
+            if (dot(other, other) > 1e-12) {
+                vec2 sum = normal + normalize(vec2(-other.y, other.x));
+                if (dot(sum, sum) > 1e-6) miter = normalize(sum); // При развороте на 180 градусов остается нормаль.
+            }
+            offset = miter * side * half_width / max(dot(miter, normal), 1.0 / miter_limit);
+        }
+        segment_coord = vec2(dot(p + offset - a, dir), side * half_width);
+        segment_length = len;
+        color = atB ? color_b : color_a;
+        gl_Position = vec4((p + offset) / half_size, atB ? point_b.z : point_a.z, 1.0);
+    }
+)glsl";
+
+// Фрагментный шейдер толстых линий: при скруглении отбрасывает точки дальше полутолщины от отрезка.
+const char* FRAGMENT_SHADER_THICK_LINE = R"glsl(
+    #version 400
+    in vec3 color;
+    in vec2 segment_coord;
+    flat in float segment_length;
+    uniform float line_width = 1.0;
+    uniform bool line_round = false;
+    out vec4 frag_color;
+    void main() {
+        if (line_round && length(segment_coord - vec2(clamp(segment_coord.x, 0.0, segment_length), 0.0)) > line_width * 0.5) discard;
+        frag_color = vec4(color, 1.0);
+    }
+)glsl";
 
 // Прототипы функций для предварительного объявления.
 void printHelp();
-void processInput(GLFWwindow* window, float deltaTime);
+LaunchOptions parseLaunchOptions(int argc, char** argv);
+int runHeadless(AppState& state, const LaunchOptions& options);
+void printIndexStats(const std::vector<const Model*>& models);
+int checkGoldenHashes(const std::map<int, uint64_t>& hashes, const std::string& path);
+void sceneChanged(SimState& sim);
+void processKey(SimState& sim, const InputEvent& event);
+void processInput(SimState& sim, float deltaTime);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void window_size_callback(GLFWwindow* window, int width, int height);
-GLuint createShaderProgram(const char* vertex_shader_src, const char* fragment_shader_src);
-std::vector<glm::vec3> getRegularPolygonVerticesCoordinates(int n, double r = 0.8);
-GLFWwindow* InitAll(int w, int h, void* user_data);
+void window_refresh_callback(GLFWwindow* window);
+GLFWwindow* InitAll(int w, int h, void* user_data, bool headless = false);
 
 
 // Главная функция, точка входа в программу.
-int main() {
-    srand((unsigned int)time(NULL)); // Инициализация генератора случайных чисел.
-
+int main(int argc, char** argv) {
+    LaunchOptions options = parseLaunchOptions(argc, argv); // Разбор аргументов командной строки.
+    // Инициализация генератора случайных чисел. Для сравнения с эталоном цвета заданий должны совпадать от запуска к запуску.
+    srand(options.goldenFile.empty() ? (unsigned int)time(NULL) : 1u);
+    if (options.benchRaster) return runRasterizerBenchmark(); // Режим замера программного растеризатора: окно и контекст не нужны.
+    if (!options.meshInput.empty()) return runMeshConverter(options); // Конвертация сетки: тоже без окна.
+    // GLFW завершается при выходе из main последним, уже после того, как модели и кэши удалят свои объекты OpenGL.
+    struct GlfwSession { ~GlfwSession() { glfwTerminate(); } } glfwSession;
     AppState state; // Создание экземпляра структуры состояния.
-    GLFWwindow* window = InitAll(state.winWidth, state.winHeight, &state); // Инициализация библиотек и создание окна приложения.
+    GLFWwindow* window = InitAll(state.winWidth, state.winHeight, &state, options.headless); // Инициализация библиотек и создание окна приложения.
     if (window == nullptr) return -1; // Проверка на случай ошибки при создании окна.
+    int swapInterval = options.swapInterval;
+    if (swapInterval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")) swapInterval = 1;
+    glfwSwapInterval(swapInterval); // Адаптивная синхронизация без поддержки драйвером заменяется обычной.
 
-    printHelp(); // Вывод справки по управлению в консоль.
+    if (!options.headless) printHelp(); // Вывод справки по управлению в консоль.
 
     // Инициализация ресурсов
-    state.smoothShaderProgram = createShaderProgram(VERTEX_SHADER_SMOOTH, FRAGMENT_SHADER_SMOOTH); // Компиляция шейдеров при запуске.
-    state.flatShaderProgram = createShaderProgram(VERTEX_SHADER_FLAT, FRAGMENT_SHADER_FLAT);
+    if (options.clearShaderCache) state.shaderCache.clear(); // Холодный запуск: все программы будут скомпилированы заново.
+    double shaderStart = glfwGetTime();
+    state.smoothShaderProgram = state.shaderCache.getProgram(VERTEX_SHADER_SMOOTH, FRAGMENT_SHADER_SMOOTH); // Компиляция шейдеров или загрузка из кэша.
+    state.flatShaderProgram = state.shaderCache.getProgram(VERTEX_SHADER_FLAT, FRAGMENT_SHADER_FLAT);
+    state.instancedShaderProgram = state.shaderCache.getProgram(VERTEX_SHADER_INSTANCED, FRAGMENT_SHADER_SMOOTH);
+    state.lineShaderProgram = state.shaderCache.getProgram(VERTEX_SHADER_THICK_LINE, FRAGMENT_SHADER_THICK_LINE);
+    state.pointShaderProgram = state.shaderCache.getProgram(VERTEX_SHADER_SMOOTH, FRAGMENT_SHADER_POINT_SPRITE);
+    if (!state.smoothShaderProgram || !state.flatShaderProgram || !state.instancedShaderProgram || !state.lineShaderProgram || !state.pointShaderProgram) return -1;
+    std::cout << "Shader programs ready in " << std::fixed << std::setprecision(2) << (glfwGetTime() - shaderStart) * 1000.0 << " ms ("
+        << state.shaderCache.hits << " from cache, " << state.shaderCache.misses << " compiled)\n";
+
+    if (options.benchLayout) return runLayoutBenchmark(state); // Режим замера: сравниваем форматы вершин и завершаем работу.
+    if (options.checkLeaks) return runLeakCheck(state); // Режим проверки: многократная перезагрузка геометрии.
+    if (options.benchQueue) return runDrawQueueBenchmark(state); // Режим замера: сортировка очереди отрисовки.
+    if (options.benchMultiDraw) return runMultiDrawBenchmark(state); // Режим замера: мультиотрисовка из общего буфера.
+    if (options.benchInstancing) return runInstancingBenchmark(state); // Режим замера: инстансинг.
+    if (options.benchStream) return runStreamingBenchmark(state); // Режим замера: потоковая передача вершин.
+    if (options.benchMeshGen) return runMeshGeneratorBenchmark(); // Режим замера: генерация сеток.
+    if (options.benchTriangulator) return runTriangulatorBenchmark(); // Режим замера: триангуляция больших контуров.
+    if (options.checkTriangulator) return runTriangulatorCheck(); // Режим проверки: триангуляция фигур заданий.
+    if (options.benchMeshOpt) return runMeshOptimizerBenchmark(state); // Режим замера: порядок индексов для кэша вершин.
+    if (options.benchIndexWidth) return runIndexWidthBenchmark(state); // Режим замера: ширина индексов и мешлеты.
+    if (options.benchLines) return runLineBenchmark(state); // Режим замера: толстые линии.
+    if (options.benchPoints) return runPointBenchmark(state); // Режим замера: сглаженные точки.
+    if (options.benchMeshFile) return runMeshFileBenchmark(state); // Режим замера: загрузка сетки из файла.
+    if (options.software) { // Команды очереди выполняет программный растеризатор; модели сохранят копии геометрии при загрузке.
+        softwareRasterizer().setShading(state.flatShaderProgram, Shading::Flat);
+        drawQueue().backend = &softwareRasterizer();
+    }
 
     // Создание и настройка всех моделей для каждого задания.
     Model task1And2Model;
     const int num_sides_task1 = 7;
-    task1And2Model.load_coords(getRegularPolygonVerticesCoordinates(num_sides_task1));
-    task1And2Model.load_colors(std::vector<glm::vec3>(num_sides_task1, glm::vec3(0.8f, 0.8f, 0.8f)));
+    task1And2Model.load_vertices(getRegularPolygonVerticesCoordinates(num_sides_task1), std::vector<glm::vec3>(num_sides_task1, glm::vec3(0.8f, 0.8f, 0.8f)), VertexLayout::Interleaved, &state.geometryCache);
+    task1And2Model.setName("task1And2");
     task1And2Model.setShaderProgram(state.smoothShaderProgram);
+    state.task1And2 = &task1And2Model;
 
     Model task3Model;
     std::vector<glm::vec3> task3_vertices = {
         {-1, 0.5, 0},   {-0.8, -0.3, 0}, {-0.6, 0.2, 0}, {-0.1, 0.2, 0},
         {-0.3, 0.8, 0}, {1, 0.8, 0},     {0.2, -0.3, 0} };
-    task3Model.load_coords(task3_vertices);
-    task3Model.load_colors(std::vector<glm::vec3>(task3_vertices.size(), glm::vec3(0.8, 0.8, 0.8)));
+    task3Model.load_vertices(task3_vertices, std::vector<glm::vec3>(task3_vertices.size(), glm::vec3(0.8, 0.8, 0.8)), VertexLayout::Interleaved, &state.geometryCache);
+    task3Model.setName("task3");
     task3Model.setShaderProgram(state.smoothShaderProgram);
+    state.task3 = &task3Model;
 
-    std::vector<glm::vec3> fig2Vertices = {
-         {0.2f, 0.0f, 0},  {0.6f, 0.0f, 0},  {0.6f, -0.3f, 0}, {-0.5f, -0.3f, 0},
-         {-0.1f, 0.2f, 0}, {-0.8f, 0.8f, 0}, {0.8f, 0.8f, 0},  {0.2f, 0.5f, 0} };
+    const std::vector<glm::vec3>& fig2Vertices = FIG2_VERTICES;
     std::vector<glm::vec3> fig2Colors;
     for (size_t i = 0; i < fig2Vertices.size(); ++i) {
         fig2Colors.push_back(glm::vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f));
     }
 
     Model task4Model;
-    task4Model.load_coords(fig2Vertices);
-    task4Model.load_colors(std::vector<glm::vec3>(fig2Vertices.size(), glm::vec3(0.8, 0.8, 0.8)));
+    task4Model.load_vertices(fig2Vertices, std::vector<glm::vec3>(fig2Vertices.size(), glm::vec3(0.8, 0.8, 0.8)), VertexLayout::Interleaved, &state.geometryCache);
+    task4Model.setName("task4");
     task4Model.setShaderProgram(state.smoothShaderProgram);
-
-    Model task5Triangles, task5Strip, task5Fan1, task5Fan2;
-    task5Triangles.load_coords(fig2Vertices); task5Triangles.load_colors(fig2Colors);
-    task5Triangles.load_indices({ 
-        7, 6, 5,   
-        5, 4, 7,  
-        7, 4, 0,
-        0, 4, 3,
-        3, 2, 0,
-        0, 2, 1
-        });
-    task5Strip.load_coords(fig2Vertices); task5Strip.load_colors(fig2Colors);
-    task5Strip.load_indices({ 6, 5, 7, 4, 0, 3, 1, 2});
-    task5Fan1.load_coords(fig2Vertices); task5Fan1.load_colors(fig2Colors);
-    task5Fan1.load_indices({ 7, 6, 5, 4, 0 });
-    task5Fan2.load_coords(fig2Vertices); task5Fan2.load_colors(fig2Colors);
-    task5Fan2.load_indices({ 0, 4, 3, 2, 1 });
+    state.task4 = &task4Model;
+
+    ThickPolyline task2Line, task3Line, task4Line; // Те же контуры для отрисовки четырехугольниками.
+    task2Line.load(getRegularPolygonVerticesCoordinates(num_sides_task1), std::vector<glm::vec3>(num_sides_task1, glm::vec3(0.8f, 0.8f, 0.8f)), true);
+    task3Line.load(task3_vertices, std::vector<glm::vec3>(task3_vertices.size(), glm::vec3(0.8f, 0.8f, 0.8f)), false);
+    task4Line.load(fig2Vertices, std::vector<glm::vec3>(fig2Vertices.size(), glm::vec3(0.8f, 0.8f, 0.8f)), true);
+    task2Line.setName("task2_line"); task3Line.setName("task3_line"); task4Line.setName("task4_line");
+    for (ThickPolyline* line : { &task2Line, &task3Line, &task4Line }) line->setShaderProgram(state.lineShaderProgram);
+    state.task2Line = &task2Line; state.task3Line = &task3Line; state.task4Line = &task4Line;
+
+    Model task5Triangles, task5Strip;
+    task5Triangles.setName("task4And5_triangles"); task5Strip.setName("task4And5_strip");
+    task5Triangles.load_vertices(fig2Vertices, fig2Colors, VertexLayout::Interleaved, &state.geometryCache);
+    const TaskIndices taskIndices = buildTaskIndices(); // Треугольники, полосы и вееры строятся по контуру.
+    task5Triangles.load_indices(GL_TRIANGLES, taskIndices.fig2Triangles, &state.geometryCache, true);
+    task5Strip.load_vertices(fig2Vertices, fig2Colors, VertexLayout::Interleaved, &state.geometryCache);
+    task5Strip.load_indices(GL_TRIANGLE_STRIP, taskIndices.fig2Strips, &state.geometryCache);
+    MeshArena task5Fans;
+    task5Fans.name = "task4And5_fans";
+    GLint fig2BaseVertex = task5Fans.addVertices(fig2Vertices, fig2Colors);
+    for (const std::vector<GLuint>& fan : taskIndices.fig2Fans) task5Fans.addMesh(fig2BaseVertex, fan);
+    task5Fans.upload();
     state.task4And5_triangles = &task5Triangles;
     state.task4And5_strip = &task5Strip;
-    state.task4And5_fan1 = &task5Fan1; 
-    state.task4And5_fan2 = &task5Fan2;
+    state.task4And5_fans = &task5Fans;
 
     Model task6Model;
     const int num_sides_task6 = 7; 
-    task6Model.load_coords(getRegularPolygonVerticesCoordinates(num_sides_task6));
     std::vector<glm::vec3> task6Colors;
     for (int i = 0; i < num_sides_task6; ++i) {
         task6Colors.push_back(glm::vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f));
     }
-    task6Model.load_colors(task6Colors);
-    task6Model.load_indices({ 0, 1, 2, 3, 4, 5, 6 });
+    task6Model.load_vertices(getRegularPolygonVerticesCoordinates(num_sides_task6), task6Colors, VertexLayout::Interleaved, &state.geometryCache);
+    task6Model.load_indices(GL_TRIANGLE_FAN, { 0, 1, 2, 3, 4, 5, 6 }, &state.geometryCache);
+    task6Model.setName("task6");
     task6Model.setShaderProgram(state.flatShaderProgram);
+    state.task6 = &task6Model;
 
     Model task7And8Model_flat, task7And8Model_smooth;
-    std::vector<glm::vec3> fig3Vertices = {
-        {0.2, -0.2, 0}, {0.7, 0.2, 0}, {0.5, 0.7, 0},
-        {-0.3, 0.9, 0}, {-0.8, 0.1, 0}, {-0.4, -0.3, 0},
-        {-0.1, -0.1, 0}, {-0.5, 0.0, 0}, {0.0, 0.6, 0}
-    };
+    const std::vector<glm::vec3>& fig3Vertices = FIG3_VERTICES;
     std::vector<glm::vec3> fig3Colors;
     for (int i = 0; i < 9; ++i) {
         fig3Colors.push_back(glm::vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f));
     }
-    std::vector<GLuint> fig3Indices = {
-        0, 1, 8,
-        8, 1, 2,
-        8, 2, 3,
-        3, 8, 4,
-        4, 7, 5,
-        5, 6, 7,
-        4, 7, 8
-    };
-    task7And8Model_flat.load_coords(fig3Vertices); task7And8Model_flat.load_colors(fig3Colors);
-    task7And8Model_flat.load_indices(fig3Indices);
+    const std::vector<GLuint>& fig3Indices = taskIndices.fig3Triangles; // Задние грани нужны заданию 8 (см. FIG3_TRIANGLES_MANUAL).
+    task7And8Model_flat.load_vertices(fig3Vertices, fig3Colors, VertexLayout::Interleaved, &state.geometryCache);
+    task7And8Model_flat.load_indices(GL_TRIANGLES, fig3Indices, &state.geometryCache, true);
+    task7And8Model_flat.setName("task7And8_flat");
     task7And8Model_flat.setShaderProgram(state.flatShaderProgram);
-    task7And8Model_smooth.load_coords(fig3Vertices); task7And8Model_smooth.load_colors(fig3Colors);
-    task7And8Model_smooth.load_indices(fig3Indices);
+    task7And8Model_smooth.load_vertices(fig3Vertices, fig3Colors, VertexLayout::Interleaved, &state.geometryCache);
+    task7And8Model_smooth.load_indices(GL_TRIANGLES, fig3Indices, &state.geometryCache, true);
+    task7And8Model_smooth.setName("task7And8_smooth");
     task7And8Model_smooth.setShaderProgram(state.smoothShaderProgram);
     state.task7And8_flat = &task7And8Model_flat; state.task7And8_smooth = &task7And8Model_smooth;
 
-    float lastFrame = 0.0f; // Переменная для расчета времени кадра 
-
-    // Главный цикл рендеринга, работает до закрытия окна.
-    while (!glfwWindowShouldClose(window)) {
-        float currentFrame = (float)glfwGetTime(); // Расчет времени, прошедшего с предыдущего кадра.
-        float deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        processInput(window, deltaTime); // Обработка непрерывных нажатий клавиш (удержание).
-
-        glViewport(0, 0, state.winWidth, state.winHeight); // Установка области отрисовки в соответствии с размером окна.
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Очистка буферов цвета и глубины.
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); // Сброс режима отрисовки полигонов на стандартный (заливка).
-        glDisable(GL_POINT_SMOOTH); // По умолчанию отключаем сглаживание, чтобы включать только где нужно.
-
-        // Выбор логики отрисовки в зависимости от текущего задания.
-        switch (state.currentTask) {
-        case 1: // Задание 1: отрисовка сглаженных точек.
-            glPointSize(state.pointSmoothSize);
-            glEnable(GL_POINT_SMOOTH);
-            task1And2Model.render(GL_POINTS);
-            break;
-        case 2: // Задание 2: отрисовка контура линиями.
-            glLineWidth(state.lineWidth);
-            task1And2Model.render(GL_LINE_LOOP);
-            break;
-        case 3: // Задание 3: отрисовка ломаной линии.
-            glLineWidth(3.0f);
-            task3Model.render(GL_LINE_STRIP);
-            break;
-        case 4: // Задание 4: отрисовка замкнутой ломаной линии.
-            glLineWidth(3.0f);
-            task4Model.render(GL_LINE_LOOP);
-            break;
-        case 5: // Задание 5: отрисовка фигуры разными методами.
-        {
-            GLuint shader = (state.toningMode == ToningMode::Flat) ? state.flatShaderProgram : state.smoothShaderProgram;
-
-            if (state.task5Mode == Task5Mode::Triangles) {
-                state.task4And5_triangles->setShaderProgram(shader);
-                state.task4And5_triangles->render(GL_TRIANGLES);
-            }
-            else if (state.task5Mode == Task5Mode::Strip) {
-                state.task4And5_strip->setShaderProgram(shader);
-                state.task4And5_strip->render(GL_TRIANGLE_STRIP);
-            }
-            else if (state.task5Mode == Task5Mode::Fan) {
-                // Рисуем оба веера, чтобы покрыть всю фигуру
-                state.task4And5_fan1->setShaderProgram(shader);
-                state.task4And5_fan1->render(GL_TRIANGLE_FAN);
+    state.geometryCache.printStats();
+    printIndexStats({ &task5Triangles, &task7And8Model_flat, &task7And8Model_smooth }); // Модели, рисуемые списком треугольников.
+
+    FrameCapture capture; // Для --golden без --capture кадры не записываются, считаются только хэши.
+    if (!options.captureOutput.empty() || !options.goldenFile.empty()) {
+        if (!capture.start(options.captureOutput)) { std::cerr << "ERROR: cannot open " << options.captureOutput << "\n"; return -1; }
+        state.capture = &capture;
+    }
 
-                state.task4And5_fan2->setShaderProgram(shader);
-                state.task4And5_fan2->render(GL_TRIANGLE_FAN);
+    if (options.bench) return runTaskBenchmark(state, options); // Режим замера: все задания с записью процентилей в файл.
+    if (options.checkGpuTimer) return runGpuTimerCheck(state, options); // Режим проверки: асинхронное чтение меток времени GPU.
+    if (options.checkGLState) return runGLStateCheck(state, options); // Режим проверки: счетчики кэша состояния.
+    if (options.benchCapture) return runCaptureBenchmark(state); // Режим замера: чтение кадров заданий.
+    if (options.headless) return runHeadless(state, options); // Без окна: отрисовываем задания во внеэкранный буфер и выводим время кадра.
+
+    drawQueue().timer = &state.gpuTimer; // Замер времени GPU по моделям в интерактивном режиме.
+    SimState initialSim;
+    initialSim.scene = state;
+    appLog().start(); // Сообщения потока симуляции выводятся фоновым потоком.
+    // Ввод обрабатывается в потоке симуляции с фиксированным шагом; без удерживаемых клавиш поток спит до следующего события.
+    state.simulation.start(initialSim, processKey, processInput, [](const SimState& sim) { return !sim.keyUpHeld && !sim.keyDownHeld; });
+
+    int result = 0;
+    if (options.benchIdle) result = runIdleBenchmark(state, window, options); // Режим замера: простой в разных режимах перерисовки.
+    else runRenderLoop(state, window, options); // Главный цикл рендеринга, работает до закрытия окна.
+    state.simulation.stop();
+    appLog().stop();
+
+    return result; // Ресурсы GLFW освобождаются в деструкторе glfwSession.
+}
+
+// Главный цикл: отрисовка и обработка событий до закрытия окна (или duration секунд, если больше 0).
+// В режиме по требованию кадр рисуется, только когда изменилась сцена (новый номер revision в снимке симуляции)
+// или окно (redraw), а между кадрами поток спит в glfwWaitEventsTimeout. Поток симуляции будит его через sceneChanged.
+RenderLoopStats runRenderLoop(AppState& state, GLFWwindow* window, const LaunchOptions& options, double duration) {
+    const double idleTimeout = 1.0; // Страховочное пробуждение в простое, секунд.
+    RenderLoopStats stats;
+    unsigned long renderedRevision = 0;
+    double start = glfwGetTime(), frameEnd = start;
+    state.redraw = true;
+    while (!glfwWindowShouldClose(window) && (duration <= 0.0 || glfwGetTime() - start < duration)) {
+        const SimState& snapshot = state.simulation.latest();
+        if (snapshot.revision != renderedRevision) state.redraw = true;
+        if (state.redraw || !options.onDemand) {
+            static_cast<SceneSettings&>(state) = snapshot.scene; // Настройки из последнего снимка симуляции.
+            renderedRevision = snapshot.revision;
+            state.redraw = false;
+            if (options.onDemand) state.profiler.resume();
+
+            state.profiler.beginFrame(state.currentTask);
+            state.gpuTimer.beginFrame();
+            renderScene(state); // Отрисовка текущего задания.
+            state.profiler.endFrame(drawQueue().lastFlush.drawCalls);
+            captureFrame(state); // Чтение заднего буфера до обмена (только с --capture).
+            glfwSwapBuffers(window); // Обмен переднего и заднего буферов для вывода изображения на экран.
+            stats.frames++;
+            if (options.maxFps > 0.0) { // Ограничение частоты: ждем начала следующего интервала кадра.
+                double wait = frameEnd + 1.0 / options.maxFps - glfwGetTime();
+                if (wait > 0.0) std::this_thread::sleep_for(std::chrono::duration<double>(wait));
             }
+            frameEnd = glfwGetTime();
+            state.profiler.presented();
         }
+        stats.wakeups++;
+        if (options.onDemand && !state.redraw) glfwWaitEventsTimeout(idleTimeout); // Ожидание ввода, изменения окна или сцены.
+        else glfwPollEvents(); // Опрос событий ввода (клавиатура, мышь).
+    }
+    return stats;
+}
+
+// Функция отрисовывает один кадр текущего задания в привязанный буфер кадра.
+// Изменения состояния идут через glState(), поэтому неизменившиеся от кадра к кадру вызовы не доходят до драйвера.
+void renderScene(AppState& state) {
+    drawQueue().backend->beginFrame(state.winWidth, state.winHeight); // Область отрисовки по размеру окна и очистка цвета и глубины.
+    DrawState& draw = drawQueue().state; // Состояние для команд этого кадра: заливка полигонов и точки без сглаживания.
+    draw = DrawState();
+    // Программный растеризатор не выполняет шейдеры, поэтому линии заданий 2-4 рисует сам (по толщине из draw.lineWidth).
+    bool softwareLines = drawQueue().backend->usesCpuGeometry();
+
+    // Выбор логики отрисовки в зависимости от текущего задания.
+    switch (state.currentTask) {
+    case 1: // Задание 1: отрисовка сглаженных точек.
+        draw.pointSize = state.pointSmoothSize;
+        draw.pointSmooth = true;
+        draw.blend = true; // Смешивание нужно только для краев точек.
+        state.task1And2->setShaderProgram(state.pointShaderProgram);
+        state.task1And2->render(GL_POINTS);
         break;
-        case 6: // Задание 6: отрисовка многоугольника веером треугольников.
-            task6Model.render(GL_TRIANGLE_FAN);
-            break;
-        case 7: // Задание 7: отрисовка фигуры с выбором тонирования.
-            if (state.toningMode == ToningMode::Flat) { state.task7And8_flat->render(GL_TRIANGLES); }
-            else { state.task7And8_smooth->render(GL_TRIANGLES); }
-            break;
-        case 8: // Задание 8: разные режимы отображения граней.
-            glPointSize(14.0f);
-            if (state.task8Mode == Task8Mode::Vertices) { glPolygonMode(GL_FRONT_AND_BACK, GL_POINT); }
-            else if (state.task8Mode == Task8Mode::FillFrontLineBack) { glPolygonMode(GL_FRONT, GL_FILL); glPolygonMode(GL_BACK, GL_LINE); }
-            else if (state.task8Mode == Task8Mode::Wireframe) { glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); }
-            state.task7And8_flat->render(GL_TRIANGLES);
-            break;
-        }
+    case 2: // Задание 2: отрисовка контура линиями.
+        draw.lineWidth = state.lineWidth;
+        draw.lineJoin = state.lineJoin;
+        if (softwareLines) { state.task1And2->setShaderProgram(state.smoothShaderProgram); state.task1And2->render(GL_LINE_LOOP); }
+        else state.task2Line->render();
+        break;
+    case 3: // Задание 3: отрисовка ломаной линии.
+        draw.lineWidth = 3.0f;
+        draw.lineJoin = state.lineJoin;
+        if (softwareLines) state.task3->render(GL_LINE_STRIP);
+        else state.task3Line->render();
+        break;
+    case 4: // Задание 4: отрисовка замкнутой ломаной линии.
+        draw.lineWidth = 3.0f;
+        draw.lineJoin = state.lineJoin;
+        if (softwareLines) state.task4->render(GL_LINE_LOOP);
+        else state.task4Line->render();
+        break;
+    case 5: // Задание 5: отрисовка фигуры разными методами.
+    {
+        GLuint shader = (state.toningMode == ToningMode::Flat) ? state.flatShaderProgram : state.smoothShaderProgram;
 
-        glfwPollEvents(); // Опрос событий ввода (клавиатура, мышь).
-        glfwSwapBuffers(window); // Обмен переднего и заднего буферов для вывода изображения на экран.
+        if (state.task5Mode == Task5Mode::Triangles) {
+            state.task4And5_triangles->setShaderProgram(shader);
+            state.task4And5_triangles->render(GL_TRIANGLES);
+        }
+        else if (state.task5Mode == Task5Mode::Strip) {
+            state.task4And5_strip->setShaderProgram(shader);
+            state.task4And5_strip->render(GL_TRIANGLE_STRIP);
+        }
+        else if (state.task5Mode == Task5Mode::Fan) {
+            // Рисуем все вееры, чтобы покрыть всю фигуру (одним вызовом мультиотрисовки)
+            for (size_t fan = 0; fan < state.task4And5_fans->meshCount(); ++fan) state.task4And5_fans->draw(fan);
+            state.task4And5_fans->submit(shader, GL_TRIANGLE_FAN);
+        }
     }
-
-    glfwTerminate(); // Освобождение ресурсов GLFW перед выходом.
-    return 0;
+    break;
+    case 6: // Задание 6: отрисовка многоугольника веером треугольников.
+        state.task6->render(GL_TRIANGLE_FAN);
+        break;
+    case 7: // Задание 7: отрисовка фигуры с выбором тонирования.
+        if (state.toningMode == ToningMode::Flat) { state.task7And8_flat->render(GL_TRIANGLES); }
+        else { state.task7And8_smooth->render(GL_TRIANGLES); }
+        break;
+    case 8: // Задание 8: разные режимы отображения граней.
+        draw.pointSize = 14.0f;
+        if (state.task8Mode == Task8Mode::Vertices) { draw.polygonFront = draw.polygonBack = GL_POINT; }
+        else if (state.task8Mode == Task8Mode::FillFrontLineBack) { draw.polygonFront = GL_FILL; draw.polygonBack = GL_LINE; }
+        else if (state.task8Mode == Task8Mode::Wireframe) { draw.polygonFront = draw.polygonBack = GL_LINE; }
+        state.task7And8_flat->render(GL_TRIANGLES);
+        break;
+    }
+    drawQueue().flush(); // Отправка накопленных за кадр команд.
 }
 
 // Функция выводит в консоль подробную инструкцию по управлению.
@@ -324,7 +444,20 @@ void printHelp() {
     std::cout << "  [1] - [8]    : Switch Task\n";
     std::cout << "  [V]          : Enable Flat Shading\n";
     std::cout << "  [B]          : Enable Smooth Shading\n";
+    std::cout << "  [J]          : Toggle Miter/Round Line Joins (Tasks 2-4)\n";
+    std::cout << "  [P]          : Print Frame Timings per Task\n";
+    std::cout << "  [G]          : Print GPU Time per Model\n";
     std::cout << "  [ESC]        : Close Application\n\n";
+    std::cout << "  Launch options: --continuous, --vsync 0|1|-1, --fps-cap N,\n"
+        << "                  --headless [--task N] [--frames N] [--software], --bench [--frames N] [--out FILE.csv|FILE.json],\n"
+        << "                  --bench-layout, --bench-queue, --bench-multidraw,\n"
+        << "                  --bench-instancing, --bench-stream, --bench-meshgen,\n"
+        << "                  --bench-triangulator, --bench-meshopt, --bench-index, --bench-raster,\n"
+        << "                  --bench-lines, --bench-points, --bench-idle, --bench-capture,\n"
+        << "                  --capture FILE.ppm|FILE.y4m|FILE.rgba, --golden FILE [--task N] [--frames N],\n"
+        << "                  --convert-mesh IN.txt OUT.cgm [--layout interleaved|packed|half|snorm16|...], --bench-meshfile,\n"
+        << "                  --check-triangulator, --check-leaks, --check-gpu-timer, --check-gl-state,\n"
+        << "                  --clear-shader-cache\n";
     std::cout << "\n";
     std::cout << "  Task 1:\n";
     std::cout << "    [UP/DOWN]  : Increase/decrease point size\n";
@@ -341,149 +474,323 @@ void printHelp() {
     std::cout << "\n";
 }
 
-// Функция обрабатывает удержание клавиш с задержкой.
-void processInput(GLFWwindow* window, float deltaTime) {
-    AppState* state = static_cast<AppState*>(glfwGetWindowUserPointer(window));
+// Функция разбирает аргументы командной строки.
+LaunchOptions parseLaunchOptions(int argc, char** argv) {
+    LaunchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0) options.headless = true;
+        else if (strcmp(argv[i], "--task") == 0 && i + 1 < argc) options.task = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) options.frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench-layout") == 0) options.benchLayout = options.headless = true;
+        else if (strcmp(argv[i], "--check-leaks") == 0) options.checkLeaks = options.headless = true;
+        else if (strcmp(argv[i], "--bench-queue") == 0) options.benchQueue = options.headless = true;
+        else if (strcmp(argv[i], "--bench-multidraw") == 0) options.benchMultiDraw = options.headless = true;
+        else if (strcmp(argv[i], "--bench-instancing") == 0) options.benchInstancing = options.headless = true;
+        else if (strcmp(argv[i], "--bench-stream") == 0) options.benchStream = options.headless = true;
+        else if (strcmp(argv[i], "--bench-meshgen") == 0) options.benchMeshGen = options.headless = true;
+        else if (strcmp(argv[i], "--bench-triangulator") == 0) options.benchTriangulator = options.headless = true;
+        else if (strcmp(argv[i], "--check-triangulator") == 0) options.checkTriangulator = options.headless = true;
+        else if (strcmp(argv[i], "--bench-meshopt") == 0) options.benchMeshOpt = options.headless = true;
+        else if (strcmp(argv[i], "--bench-index") == 0) options.benchIndexWidth = options.headless = true;
+        else if (strcmp(argv[i], "--bench-lines") == 0) options.benchLines = options.headless = true;
+        else if (strcmp(argv[i], "--bench-points") == 0) options.benchPoints = options.headless = true;
+        else if (strcmp(argv[i], "--software") == 0) options.software = options.headless = true;
+        else if (strcmp(argv[i], "--bench-raster") == 0) options.benchRaster = options.headless = true;
+        else if (strcmp(argv[i], "--check-gpu-timer") == 0) options.checkGpuTimer = options.headless = true;
+        else if (strcmp(argv[i], "--check-gl-state") == 0) options.checkGLState = options.headless = true;
+        else if (strcmp(argv[i], "--continuous") == 0) options.onDemand = false;
+        else if (strcmp(argv[i], "--vsync") == 0 && i + 1 < argc) options.swapInterval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--fps-cap") == 0 && i + 1 < argc) options.maxFps = atof(argv[++i]);
+        else if (strcmp(argv[i], "--bench-idle") == 0) options.benchIdle = true;
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) options.captureOutput = argv[++i];
+        else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) { options.goldenFile = argv[++i]; options.headless = true; }
+        else if (strcmp(argv[i], "--bench-capture") == 0) options.benchCapture = options.headless = true;
+        else if (strcmp(argv[i], "--convert-mesh") == 0 && i + 2 < argc) { options.meshInput = argv[++i]; options.meshOutput = argv[++i]; options.headless = true; }
+        else if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+            if (!vertexLayoutFromName(argv[++i], options.meshLayout)) std::cerr << "WARNING: unknown vertex layout " << argv[i] << "\n";
+        }
+        else if (strcmp(argv[i], "--bench-meshfile") == 0) options.benchMeshFile = options.headless = true;
+        else if (strcmp(argv[i], "--bench") == 0) options.bench = options.headless = true;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) options.benchOutput = argv[++i];
+        else if (strcmp(argv[i], "--clear-shader-cache") == 0) options.clearShaderCache = true;
+        else std::cerr << "WARNING: unknown option " << argv[i] << "\n";
+    }
+    if (options.task < 0 || options.task > 8) options.task = 0;
+    if (options.frames < 1) options.frames = 1;
+    if (options.swapInterval < -1) options.swapInterval = -1;
+    if (options.maxFps < 0.0) options.maxFps = 0.0;
+    return options;
+}
+
+// Функция отрисовывает задания во внеэкранный буфер и выводит среднее время кадра по каждому из них.
+int runHeadless(AppState& state, const LaunchOptions& options) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    std::cout << "Headless renderer: " << drawQueue().backend->name() << "\n";
+
+    int firstTask = options.task ? options.task : 1, lastTask = options.task ? options.task : 8;
+    for (int task = firstTask; task <= lastTask; ++task) {
+        state.currentTask = task;
+        renderScene(state); glFinish(); // Прогревочный кадр, чтобы не учитывать ленивую инициализацию драйвера.
+        double start = glfwGetTime();
+        for (int frame = 0; frame < options.frames; ++frame) {
+            renderScene(state);
+            captureFrame(state);
+            glFinish(); // Дожидаемся окончания отрисовки, чтобы замерять реальное время кадра.
+            glfwPollEvents();
+        }
+        double elapsed = glfwGetTime() - start;
+        std::cout << "Task " << task << ": " << options.frames << " frames, "
+            << std::fixed << std::setprecision(3) << elapsed * 1000.0 / options.frames << " ms/frame, "
+            << std::setprecision(1) << options.frames / elapsed << " FPS, GL state calls/frame: "
+            << glState().lastFrame.issued << " issued, " << glState().lastFrame.elided << " elided\n";
+    }
+    if (!state.capture) return 0;
+    state.capture->stop(); // Дочитываем последние кадры из кольца и ждем записи.
+    if (!options.captureOutput.empty()) std::cout << "Captured " << state.capture->written << " frames to " << options.captureOutput << "\n";
+    return options.goldenFile.empty() ? 0 : checkGoldenHashes(state.capture->hashes(), options.goldenFile);
+}
+
+// Функция передает только что отрисованный кадр в state.capture: из буфера кадра OpenGL через кольцо PBO
+// или из памяти программного растеризатора. Метка кадра - номер задания.
+void captureFrame(AppState& state) {
+    if (!state.capture) return;
+    if (drawQueue().backend->usesCpuGeometry()) state.capture->submit(softwareRasterizer().pixels().data(), state.winWidth, state.winHeight, state.currentTask);
+    else state.capture->capture(state.winWidth, state.winHeight, state.currentTask);
+}
+
+// Функция сравнивает хэши последних кадров заданий со строками "task N HASH" файла эталонов.
+// Если файла нет, он создается из текущих хэшей. Эталоны зависят от драйвера и растеризатора (--software),
+// поэтому хранятся отдельно для каждой машины CI. Возвращает 1, если хотя бы одно задание не совпало.
+int checkGoldenHashes(const std::map<int, uint64_t>& hashes, const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::ofstream out(path);
+        for (const auto& entry : hashes) out << "task " << entry.first << " " << std::hex << std::setw(16) << std::setfill('0') << entry.second << std::dec << std::setfill(' ') << "\n";
+        if (!out) { std::cerr << "ERROR: cannot write " << path << "\n"; return -1; }
+        std::cout << "Golden hashes for " << hashes.size() << " tasks written to " << path << "\n";
+        return 0;
+    }
+    std::map<int, uint64_t> golden;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string word; int task = 0; uint64_t hash = 0;
+        if (fields >> word >> task >> std::hex >> hash && word == "task") golden[task] = hash;
+    }
+    int failed = 0;
+    for (const auto& entry : hashes) {
+        auto it = golden.find(entry.first);
+        const char* result = it == golden.end() ? "NO REFERENCE" : it->second == entry.second ? "OK" : "MISMATCH";
+        if (strcmp(result, "OK") != 0) failed++;
+        std::cout << "Golden task " << entry.first << ": " << std::hex << std::setw(16) << std::setfill('0') << entry.second << std::dec << std::setfill(' ') << " " << result << "\n";
+    }
+    std::cout << (failed ? "Golden image check FAILED: " : "Golden image check passed: ") << failed << " of " << hashes.size() << " tasks differ\n";
+    return failed ? 1 : 0;
+}
+
+// Функция строит индексы фигур заданий 4-8 для моделей main и для --check-triangulator.
+// Фигура 3 остается ручной: задние грани (3, 8, 4) и (4, 7, 5) нужны заданию 8, а Triangulator их не строит.
+TaskIndices buildTaskIndices() {
+    TaskIndices indices;
+    indices.fig2Triangles = triangulatePolygon(FIG2_VERTICES);
+    indices.fig2Strips = trianglesToStrips(indices.fig2Triangles);
+    indices.fig2Fans = trianglesToFans(indices.fig2Triangles);
+    indices.fig3Triangles = FIG3_TRIANGLES_MANUAL;
+    return indices;
+}
+
+// Функция выводит ACMR индексов моделей до и после оптимизации порядка треугольников.
+void printIndexStats(const std::vector<const Model*>& models) {
+    std::cout << "Index order (ACMR, FIFO cache of " << VERTEX_CACHE_SIZE << "):" << std::fixed << std::setprecision(3);
+    for (const Model* model : models) {
+        const IndexOrderStats& stats = model->index_stats();
+        std::cout << " " << model->get_name() << " " << stats.acmrBefore << (stats.optimized ? " -> " : " = ") << stats.acmrAfter
+            << " (" << stats.triangles << " triangles);";
+    }
+    std::cout << "\n";
+}
+
+// Функция обрабатывает удержание клавиш с задержкой. Вызывается потоком симуляции с фиксированным шагом deltaTime,
+// поэтому скорость изменения размера точек и толщины линий не зависит от частоты кадров.
+// Сообщения идут через appLog(): вывод выполняет фоновый поток, а частые изменения при удержании прореживаются.
+void processInput(SimState& sim, float deltaTime) {
+    SceneSettings& scene = sim.scene;
 
     const float holdDelay = 0.5f; // Задержка в секундах перед началом непрерывного изменения
     const float pointChangeSpeed = 50.0f;
     const float lineChangeSpeed = 5.0f;
 
-    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-        state->keyHoldTimeUp += deltaTime; // Увеличиваем счетчик времени удержания
+    if (sim.keyUpHeld) {
+        sim.keyHoldTimeUp += deltaTime; // Увеличиваем счетчик времени удержания
     }
     else {
-        state->keyHoldTimeUp = 0.0f; // Сбрасываем счетчик, если клавиша отпущена
+        sim.keyHoldTimeUp = 0.0f; // Сбрасываем счетчик, если клавиша отпущена
     }
 
-    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-        state->keyHoldTimeDown += deltaTime;
+    if (sim.keyDownHeld) {
+        sim.keyHoldTimeDown += deltaTime;
     }
     else {
-        state->keyHoldTimeDown = 0.0f;
+        sim.keyHoldTimeDown = 0.0f;
     }
 
-    if (state->keyHoldTimeUp > holdDelay) {
-        if (state->currentTask == 1) state->pointSmoothSize += pointChangeSpeed * deltaTime;
-        if (state->currentTask == 2) state->lineWidth += lineChangeSpeed * deltaTime;
+    if (sim.keyHoldTimeUp > holdDelay) {
+        if (scene.currentTask == 1) scene.pointSmoothSize += pointChangeSpeed * deltaTime;
+        if (scene.currentTask == 2) scene.lineWidth += lineChangeSpeed * deltaTime;
     }
-    if (state->keyHoldTimeDown > holdDelay) {
-        if (state->currentTask == 1) {
-            state->pointSmoothSize -= pointChangeSpeed * deltaTime;
-            if (state->pointSmoothSize < 1.0f) state->pointSmoothSize = 1.0f;
+    if (sim.keyHoldTimeDown > holdDelay) {
+        if (scene.currentTask == 1) {
+            scene.pointSmoothSize -= pointChangeSpeed * deltaTime;
+            if (scene.pointSmoothSize < 1.0f) scene.pointSmoothSize = 1.0f;
         }
-        if (state->currentTask == 2) {
-            state->lineWidth -= lineChangeSpeed * deltaTime;
-            if (state->lineWidth < 1.0f) state->lineWidth = 1.0f;
+        if (scene.currentTask == 2) {
+            scene.lineWidth -= lineChangeSpeed * deltaTime;
+            if (scene.lineWidth < 1.0f) scene.lineWidth = 1.0f;
         }
     }
 
-    if (state->currentTask == 1 && static_cast<int>(state->pointSmoothSize) != state->lastPrintedPointSize) {
-        state->lastPrintedPointSize = static_cast<int>(state->pointSmoothSize);
-        std::cout << "New point size: " << state->lastPrintedPointSize << std::endl;
+    bool ramping = sim.keyHoldTimeUp > holdDelay || sim.keyHoldTimeDown > holdDelay;
+    if (ramping && (scene.currentTask == 1 || scene.currentTask == 2)) sceneChanged(sim); // Размер меняется каждый шаг удержания.
+
+    if (scene.currentTask == 1 && static_cast<int>(scene.pointSmoothSize) != sim.lastPrintedPointSize) {
+        sim.lastPrintedPointSize = static_cast<int>(scene.pointSmoothSize);
+        appLog().post(LogChannel::PointSize, "New point size: " + std::to_string(sim.lastPrintedPointSize));
     }
-    if (state->currentTask == 2 && static_cast<int>(state->lineWidth) != state->lastPrintedLineWidth) {
-        state->lastPrintedLineWidth = static_cast<int>(state->lineWidth);
-        std::cout << "New line width: " << state->lastPrintedLineWidth << std::endl;
+    if (scene.currentTask == 2 && static_cast<int>(scene.lineWidth) != sim.lastPrintedLineWidth) {
+        sim.lastPrintedLineWidth = static_cast<int>(scene.lineWidth);
+        appLog().post(LogChannel::LineWidth, "New line width: " + std::to_string(sim.lastPrintedLineWidth));
     }
 }
 
-// Функция обрабатывает одиночные нажатия клавиш и сразу обновляет "запомненные" значения.
-void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    if (action != GLFW_PRESS) return; // Игнорируем события отпускания и повтора клавиш.
-    AppState* state = static_cast<AppState*>(glfwGetWindowUserPointer(window));
-
-    if (key == GLFW_KEY_ESCAPE) { glfwSetWindowShouldClose(window, true); return; }
+// Функция обрабатывает одиночные нажатия клавиш и сразу обновляет "запомненные" значения (в потоке симуляции).
+void processKey(SimState& sim, const InputEvent& event) {
+    SceneSettings& scene = sim.scene;
+    int key = event.key;
+    if (key == GLFW_KEY_UP) sim.keyUpHeld = event.action == GLFW_PRESS;
+    if (key == GLFW_KEY_DOWN) sim.keyDownHeld = event.action == GLFW_PRESS;
+    if (event.action != GLFW_PRESS) return; // Отпускание важно только для удержания.
 
     if (key >= GLFW_KEY_1 && key <= GLFW_KEY_8) {
-        state->currentTask = key - GLFW_KEY_0;
-        std::cout << ">> Switched to Task " << state->currentTask << std::endl;
+        scene.currentTask = key - GLFW_KEY_0;
+        appLog().post(">> Switched to Task " + std::to_string(scene.currentTask));
     }
 
-    if (state->currentTask == 5) {
-        if (key == GLFW_KEY_Z) { state->task5Mode = Task5Mode::Triangles; std::cout << "Task 5 Mode: Triangles\n"; }
-        if (key == GLFW_KEY_X) { state->task5Mode = Task5Mode::Strip; std::cout << "Task 5 Mode: Triangle Strip\n"; }
-        if (key == GLFW_KEY_C) { state->task5Mode = Task5Mode::Fan; std::cout << "Task 5 Mode: Triangle Fan\n"; }
+    if (scene.currentTask == 5) {
+        if (key == GLFW_KEY_Z) { scene.task5Mode = Task5Mode::Triangles; appLog().post("Task 5 Mode: Triangles"); }
+        if (key == GLFW_KEY_X) { scene.task5Mode = Task5Mode::Strip; appLog().post("Task 5 Mode: Triangle Strip"); }
+        if (key == GLFW_KEY_C) { scene.task5Mode = Task5Mode::Fan; appLog().post("Task 5 Mode: Triangle Fan"); }
     }
-    else if (state->currentTask == 8) {
-        if (key == GLFW_KEY_Z) { state->task8Mode = Task8Mode::Vertices; std::cout << "Task 8 Mode: Vertices Only\n"; }
-        if (key == GLFW_KEY_X) { state->task8Mode = Task8Mode::FillFrontLineBack; std::cout << "Task 8 Mode: Fill Front / Line Back\n"; }
-        if (key == GLFW_KEY_C) { state->task8Mode = Task8Mode::Wireframe; std::cout << "Task 8 Mode: Wireframe\n"; }
+    else if (scene.currentTask == 8) {
+        if (key == GLFW_KEY_Z) { scene.task8Mode = Task8Mode::Vertices; appLog().post("Task 8 Mode: Vertices Only"); }
+        if (key == GLFW_KEY_X) { scene.task8Mode = Task8Mode::FillFrontLineBack; appLog().post("Task 8 Mode: Fill Front / Line Back"); }
+        if (key == GLFW_KEY_C) { scene.task8Mode = Task8Mode::Wireframe; appLog().post("Task 8 Mode: Wireframe"); }
     }
 
-    if (state->currentTask == 1) { // Для размера точек
-        if (key == GLFW_KEY_UP) state->pointSmoothSize++;
-        if (key == GLFW_KEY_DOWN) state->pointSmoothSize--;
-        if (state->pointSmoothSize < 1.0f) state->pointSmoothSize = 1.0f;
+    if (scene.currentTask == 1) { // Для размера точек
+        if (key == GLFW_KEY_UP) scene.pointSmoothSize++;
+        if (key == GLFW_KEY_DOWN) scene.pointSmoothSize--;
+        if (scene.pointSmoothSize < 1.0f) scene.pointSmoothSize = 1.0f;
 
-        state->lastPrintedPointSize = static_cast<int>(state->pointSmoothSize);
-        std::cout << "New point size: " << state->lastPrintedPointSize << std::endl;
+        sim.lastPrintedPointSize = static_cast<int>(scene.pointSmoothSize);
+        appLog().post(LogChannel::PointSize, "New point size: " + std::to_string(sim.lastPrintedPointSize));
     }
-    else if (state->currentTask == 2) { // Для толщины линий
-        if (key == GLFW_KEY_UP) state->lineWidth++;
-        if (key == GLFW_KEY_DOWN) state->lineWidth--;
-        if (state->lineWidth < 1.0f) state->lineWidth = 1.0f;
+    else if (scene.currentTask == 2) { // Для толщины линий
+        if (key == GLFW_KEY_UP) scene.lineWidth++;
+        if (key == GLFW_KEY_DOWN) scene.lineWidth--;
+        if (scene.lineWidth < 1.0f) scene.lineWidth = 1.0f;
 
         // Аналогично обновляем запомненное значение для толщины линии.
-        state->lastPrintedLineWidth = static_cast<int>(state->lineWidth);
-        std::cout << "New line width: " << state->lastPrintedLineWidth << std::endl;
+        sim.lastPrintedLineWidth = static_cast<int>(scene.lineWidth);
+        appLog().post(LogChannel::LineWidth, "New line width: " + std::to_string(sim.lastPrintedLineWidth));
     }
 
-    if (key == GLFW_KEY_V) { state->toningMode = ToningMode::Flat; std::cout << ">> Shading Mode: Flat\n"; }
-    if (key == GLFW_KEY_B) { state->toningMode = ToningMode::Smooth; std::cout << ">> Shading Mode: Smooth\n"; }
+    if (key == GLFW_KEY_V) { scene.toningMode = ToningMode::Flat; appLog().post(">> Shading Mode: Flat"); }
+    if (key == GLFW_KEY_B) { scene.toningMode = ToningMode::Smooth; appLog().post(">> Shading Mode: Smooth"); }
+    if (key == GLFW_KEY_J && scene.currentTask >= 2 && scene.currentTask <= 4) {
+        scene.lineJoin = scene.lineJoin == LineJoin::Miter ? LineJoin::Round : LineJoin::Miter;
+        appLog().post(scene.lineJoin == LineJoin::Miter ? "Line Joins: Miter" : "Line Joins: Round");
+    }
+    sceneChanged(sim);
+}
+
+// Функция отмечает изменение сцены в потоке симуляции и будит главный поток, ждущий событий
+// (glfwPostEmptyEvent можно вызывать из любого потока).
+void sceneChanged(SimState& sim) {
+    sim.revision++;
+    glfwPostEmptyEvent();
+}
+
+// Функция принимает события клавиатуры в главном потоке. Команды окна и вывод замеров выполняются сразу,
+// остальные нажатия и отпускания передаются в поток симуляции.
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (action == GLFW_REPEAT) return; // Удержание отслеживается потоком симуляции по нажатию и отпусканию.
+    AppState* state = static_cast<AppState*>(glfwGetWindowUserPointer(window));
+
+    if (action == GLFW_PRESS) {
+        if (key == GLFW_KEY_ESCAPE) { glfwSetWindowShouldClose(window, true); return; }
+        if (key == GLFW_KEY_P) { state->profiler.printSummary(std::cout); return; }
+        if (key == GLFW_KEY_G) { state->gpuTimer.printSummary(std::cout); return; }
+    }
+    state->redraw = true; // Кадр перерисуется и после применения нажатия симуляцией (по новому revision).
+    state->simulation.post({ key, action });
 }
 
 // Функция вызывается при изменении размеров окна.
 void window_size_callback(GLFWwindow* window, int width, int height) {
     AppState* state = static_cast<AppState*>(glfwGetWindowUserPointer(window));
     state->winWidth = width; state->winHeight = height;
+    state->redraw = true;
 }
 
-// Функция компилирует шейдеры из строк и линкует их в одну программу.
-GLuint createShaderProgram(const char* vertex_shader_src, const char* fragment_shader_src) {
-    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vs, 1, &vertex_shader_src, NULL);
-    glCompileShader(vs);
-    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, &fragment_shader_src, NULL);
-    glCompileShader(fs);
-    GLuint shader_program = glCreateProgram();
-    glAttachShader(shader_program, fs);
-    glAttachShader(shader_program, vs);
-    glLinkProgram(shader_program);
-    glDeleteShader(vs); glDeleteShader(fs);
-    return shader_program;
+// Функция вызывается, когда содержимое окна нужно вывести заново (окно было перекрыто или свернуто).
+void window_refresh_callback(GLFWwindow* window) {
+    static_cast<AppState*>(glfwGetWindowUserPointer(window))->redraw = true;
 }
 
-// Вспомогательная функция для расчета вершин правильного многоугольника.
+// Вспомогательная функция для расчета вершин правильного многоугольника (точки окружности берутся из таблицы генератора).
 std::vector<glm::vec3> getRegularPolygonVerticesCoordinates(int n, double r) {
-    std::vector<glm::vec3> vertices;
-    float angleStep = 2.0f * (float)M_PI / n;
-    for (int i = 0; i < n; i++) {
-        float angle = i * angleStep;
-        vertices.emplace_back((float)(r * cos(angle)), (float)(r * sin(angle)), 0.0f);
-    }
+    const std::vector<glm::vec2>& circle = meshGenerator().circle(n);
+    std::vector<glm::vec3> vertices(n);
+    for (int i = 0; i < n; i++) vertices[i] = glm::vec3((float)r * circle[i], 0.0f);
     return vertices;
 }
 
 // Главная функция инициализации: создает окно и настраивает OpenGL.
-GLFWwindow* InitAll(int w, int h, void* user_data) {
+// В headless-режиме окно создается невидимым, а при отсутствии дисплея используется
+// null-платформа GLFW с программным контекстом OSMesa (llvmpipe).
+GLFWwindow* InitAll(int w, int h, void* user_data, bool headless) {
+#ifndef _WIN32
+    if (headless && !getenv("DISPLAY") && !getenv("WAYLAND_DISPLAY") && glfwPlatformSupported(GLFW_PLATFORM_NULL))
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
     if (!glfwInit()) { std::cerr << "ERROR: could not start GLFW3\n"; return nullptr; }
 
+    if (headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        if (glfwGetPlatform() == GLFW_PLATFORM_NULL) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
     GLFWwindow* window = glfwCreateWindow(w, h, "CG 2", NULL, NULL);
     if (!window) { glfwTerminate(); std::cerr << "ERROR: could not create window\n"; return nullptr; }
 
     glfwSetWindowUserPointer(window, user_data);
     glfwSetWindowSizeCallback(window, window_size_callback);
     glfwSetKeyCallback(window, key_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
     glfwMakeContextCurrent(window);
 
     glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK) { std::cerr << "ERROR: could not start GLEW\n"; return nullptr; }
-
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND); // Включение смешивания цветов, необходимо для корректной работы сглаживания.
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLenum glewStatus = glewInit();
+    // Без GLX-дисплея (контекст OSMesa) GLEW сообщает об ошибке, но функции ядра OpenGL уже загружены.
+    if (glewStatus != GLEW_OK && !(headless && glewStatus == GLEW_ERROR_NO_GLX_DISPLAY)) { std::cerr << "ERROR: could not start GLEW\n"; return nullptr; }
+
+    glState().enable(GL_DEPTH_TEST);
+    glState().enable(GL_PRIMITIVE_RESTART); // Полосы треугольников в одном буфере разделяются этим индексом.
+    glState().primitiveRestartIndex(PRIMITIVE_RESTART_INDEX);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Смешивание включается только для команд с DrawState::blend.
+    GLint profile = 0;
+    glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profile);
+    if (!(profile & GL_CONTEXT_CORE_PROFILE_BIT)) glEnable(GL_POINT_SPRITE); // В профиле совместимости gl_PointCoord задан только для спрайтов.
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f); 
 
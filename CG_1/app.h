@@ -0,0 +1,500 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <ctime>
+#include <cmath>
+#include <iomanip>
+#include <cstdint>
+#include <unordered_map>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+#define GLEW_STATIC 
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "gl_state.h"
+#include "gl_buffer.h"
+#include "draw_queue.h"
+#include "software_rasterizer.h"
+#include "vertex_format.h"
+#include "mesh_arena.h"
+#include "mesh_file.h"
+#include "thick_line.h"
+#include "mesh_generator.h"
+#include "triangulator.h"
+#include "mesh_optimizer.h"
+#include "stream_buffer.h"
+#include "hash.h"
+#include "shader_cache.h"
+#include "frame_profiler.h"
+#include "frame_capture.h"
+#include "simulation.h"
+#include "async_log.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846 // Определение константы PI, если она отсутствует.
+#endif
+
+// Перечисление для режимов отрисовки в 5-м задании.
+enum class Task5Mode {Triangles=1, Strip, Fan };
+// Перечисление для режимов отображения граней в 8-м задании.
+enum class Task8Mode { Vertices = 1, FillFrontLineBack, Wireframe };
+// Перечисление для выбора типа тонирования (закрашивания).
+enum class ToningMode { Flat = 1, Smooth };
+
+// Контур фигуры 4-го и 5-го заданий (вершины по порядку обхода).
+const std::vector<glm::vec3> FIG2_VERTICES = {
+     {0.2f, 0.0f, 0},  {0.6f, 0.0f, 0},  {0.6f, -0.3f, 0}, {-0.5f, -0.3f, 0},
+     {-0.1f, 0.2f, 0}, {-0.8f, 0.8f, 0}, {0.8f, 0.8f, 0},  {0.2f, 0.5f, 0} };
+// Контур фигуры 7-го и 8-го заданий.
+const std::vector<glm::vec3> FIG3_VERTICES = {
+    {0.2, -0.2, 0}, {0.7, 0.2, 0}, {0.5, 0.7, 0},
+    {-0.3, 0.9, 0}, {-0.8, 0.1, 0}, {-0.4, -0.3, 0},
+    {-0.1, -0.1, 0}, {-0.5, 0.0, 0}, {0.0, 0.6, 0}
+};
+// Составленные вручную индексы фигур. Индексы фигуры 2 строит buildTaskIndices, а эти списки служат эталоном для --check-triangulator.
+const std::vector<GLuint> FIG2_TRIANGLES_MANUAL = {
+    7, 6, 5,
+    5, 4, 7,
+    7, 4, 0,
+    0, 4, 3,
+    3, 2, 0,
+    0, 2, 1
+};
+const std::vector<GLuint> FIG2_STRIP_MANUAL = { 6, 5, 7, 4, 0, 3, 1, 2 };
+const std::vector<std::vector<GLuint>> FIG2_FANS_MANUAL = { { 7, 6, 5, 4, 0 }, { 0, 4, 3, 2, 1 } };
+// Фигура 3 рисуется по ручному списку: треугольники (3, 8, 4) и (4, 7, 5) обходятся по часовой стрелке, и в режиме
+// FillFrontLineBack задания 8 они видны контуром. Triangulator строит все треугольники против часовой стрелки.
+const std::vector<GLuint> FIG3_TRIANGLES_MANUAL = {
+    0, 1, 8,
+    8, 1, 2,
+    8, 2, 3,
+    3, 8, 4,
+    4, 7, 5,
+    5, 6, 7,
+    4, 7, 8
+};
+
+// Индексы фигур заданий 4-8. Их строит одна функция (buildTaskIndices) и для моделей в main, и для --check-triangulator.
+struct TaskIndices {
+    std::vector<GLuint> fig2Triangles; // Задания 4-5: триангуляция контура FIG2_VERTICES.
+    std::vector<GLuint> fig2Strips; // Полосы из тех же треугольников, разделенные PRIMITIVE_RESTART_INDEX.
+    std::vector<std::vector<GLuint>> fig2Fans; // Вееры из тех же треугольников.
+    std::vector<GLuint> fig3Triangles; // Задания 7-8: ручной список (см. FIG3_TRIANGLES_MANUAL).
+};
+
+// Кэш буферов с адресацией по содержимому: одинаковые данные загружаются в видеопамять только один раз,
+// а модели, отличающиеся лишь индексами или шейдером, ссылаются на общий буфер.
+class GeometryCache {
+private:
+    struct Entry { std::shared_ptr<GLBuffer> buffer; std::vector<unsigned char> bytes; }; // Копия данных нужна для проверки коллизий хэша.
+    std::unordered_map<uint64_t, std::vector<Entry>> entries;
+public:
+    size_t uploads = 0, reuses = 0; // Количество реальных загрузок и повторных использований буферов.
+    size_t bytesUploaded = 0, bytesSaved = 0; // Объем загруженных и сэкономленных байтов.
+
+    // Возвращает буфер с такими данными и привязывает его к target. Буфер общий, менять его на месте нельзя.
+    std::shared_ptr<GLBuffer> acquire(GLenum target, const void* data, size_t size) {
+        std::vector<Entry>& bucket = entries[hashBytes(data, size)];
+        for (const Entry& entry : bucket) {
+            if (entry.bytes.size() == size && memcmp(entry.bytes.data(), data, size) == 0) {
+                reuses++; bytesSaved += size;
+                entry.buffer->bind(target);
+                return entry.buffer;
+            }
+        }
+        Entry entry;
+        entry.buffer = std::make_shared<GLBuffer>();
+        entry.buffer->upload(target, data, size);
+        entry.bytes.assign(static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+        bucket.push_back(std::move(entry));
+        uploads++; bytesUploaded += size;
+        return bucket.back().buffer;
+    }
+    void releaseUnused() { // Удаляет буферы, на которые больше не ссылается ни одна модель.
+        for (auto it = entries.begin(); it != entries.end();) {
+            std::vector<Entry>& bucket = it->second;
+            for (size_t i = 0; i < bucket.size();) {
+                if (bucket[i].buffer.use_count() == 1) { bucket[i] = std::move(bucket.back()); bucket.pop_back(); }
+                else ++i;
+            }
+            it = bucket.empty() ? entries.erase(it) : std::next(it);
+        }
+    }
+    void printStats() const {
+        std::cout << "Geometry cache: " << uploads << " uploads (" << bytesUploaded << " bytes), "
+            << reuses << " reuses (" << bytesSaved << " bytes saved)\n";
+    }
+};
+
+// Класс для управления геометрией объекта (вершины, цвета, индексы).
+class Model {
+private:
+    GLVertexArray vao; // Объект вершинного массива (Vertex Array Object), удаляется вместе с моделью.
+    std::shared_ptr<GLBuffer> vertexBuffer, colorBuffer, indexBuffer; // Буферы модели (могут быть общими с кэшем геометрии).
+    GLBuffer instanceBuffer; // Атрибуты экземпляров для renderInstanced (только у этой модели).
+    size_t instances_count = 0; // Количество загруженных экземпляров.
+    size_t verteces_count = 0; // Количество вершин модели.
+    size_t indices_count = 0; // Количество индексов модели.
+    GLenum indexType = GL_UNSIGNED_INT; // Тип индексов в видеопамяти, выбирается load_indices по наибольшему индексу.
+    bool narrowIndices = true; // Выбирать самый узкий тип индексов (false - всегда GL_UNSIGNED_INT, для сравнения в замерах).
+    MultiDrawBatch meshlets; // Мешлеты с 16-битными индексами для сеток больше 64k вершин (drawCount 0 - мешлетов нет).
+    PositionTransform positionTransform; // Восстановление позиций сжатого формата в шейдере.
+    bool quantized = false; // Позиции хранятся в сжатом формате (isCompactLayout).
+    GLuint shaderProgramID = 0; // ID используемой шейдерной программы.
+    const char* name = "model"; // Подпись модели в замерах времени GPU (строка должна жить дольше модели).
+    IndexOrderStats indexStats; // ACMR загруженных индексов до и после оптимизации порядка (load_indices).
+    CpuMesh cpu; // Копия геометрии в памяти процессора, нужна только программному растеризатору.
+    // Загружает данные в буфер slot, оставляя его привязанным к target. Собственный буфер обновляется на месте,
+    // а при передаче кэша slot заменяется общим буфером с такими же данными (прежний освобождается).
+    void upload(std::shared_ptr<GLBuffer>& slot, GLenum target, const void* data, size_t size, GeometryCache* cache) {
+        if (cache) { slot = cache->acquire(target, data, size); return; }
+        if (!slot || slot.use_count() > 1) slot = std::make_shared<GLBuffer>(); // Общий буфер из кэша менять нельзя.
+        slot->upload(target, data, size);
+    }
+    const PositionTransform* transform() const { return quantized ? &positionTransform : nullptr; }
+    bool keepCpuGeometry() const { return drawQueue().backend->usesCpuGeometry(); } // Бэкенд очереди читает геометрию из памяти.
+    // Указатели атрибутов 0 (позиция) и 1 (цвет) для вершин формата layout (кроме Split) в привязанном GL_ARRAY_BUFFER.
+    void setVertexFormat(VertexLayout layout) {
+        GLsizei stride = (GLsizei)vertexStride(layout);
+        if (isCompactLayout(layout)) {
+            if (hasHalfPositions(layout)) glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactVertex, position));
+            else glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(CompactVertex, position));
+            if (hasRGB10A2Colors(layout)) glVertexAttribPointer(1, 4, GL_UNSIGNED_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(CompactVertex, color));
+            else glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(CompactVertex, color));
+        }
+        else if (layout == VertexLayout::Interleaved) {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(InterleavedVertex, position));
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(InterleavedVertex, color));
+        }
+        else {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, position));
+            glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(PackedVertex, color));
+        }
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+    }
+public:
+    // Главная функция отрисовки модели с заданным режимом. Команда ставится в общую очередь drawQueue()
+    // и выполняется при ее отправке (flush) вместе с командами других моделей, отсортированными по состоянию.
+    void render(GLuint mode) {
+        if (meshlets.drawCount > 0) drawQueue().pushBatch(shaderProgramID, vao.get(), mode, meshlets, name, indexType, transform(), &cpu); // Большая сетка: все мешлеты одним вызовом.
+        else if (indices_count > 0) drawQueue().push(shaderProgramID, vao.get(), mode, (GLsizei)indices_count, indexType, 1, name, transform(), &cpu); // Рисуем по индексам, если они есть.
+        else drawQueue().push(shaderProgramID, vao.get(), mode, (GLsizei)verteces_count, 0, 1, name, transform(), &cpu); // Иначе рисуем по вершинам напрямую.
+    }
+    // Отрисовка count копий модели одним вызовом. Атрибуты экземпляров задаются load_instances,
+    // а шейдер должен их читать (VERTEX_SHADER_INSTANCED). Модели, разбитые на мешлеты, так не рисуются.
+    void renderInstanced(GLuint mode, size_t count) {
+        GLsizei instances = (GLsizei)std::min(count, instances_count);
+        if (instances == 0 || meshlets.drawCount > 0) return;
+        if (indices_count > 0) drawQueue().push(shaderProgramID, vao.get(), mode, (GLsizei)indices_count, indexType, instances, name, transform(), &cpu);
+        else drawQueue().push(shaderProgramID, vao.get(), mode, (GLsizei)verteces_count, 0, instances, name, transform(), &cpu);
+    }
+    // Загрузка атрибутов экземпляров (смещение, масштаб, цвет) с делителем 1: значения меняются раз на экземпляр.
+    void load_instances(const std::vector<InstanceData>& instances) {
+        instances_count = instances.size();
+        vao.bind();
+        instanceBuffer.upload(GL_ARRAY_BUFFER, instances.data(), instances.size() * sizeof(InstanceData), GL_DYNAMIC_DRAW);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, offset));
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, scale));
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, color));
+        for (GLuint attribute = 2; attribute <= 4; ++attribute) {
+            glVertexAttribDivisor(attribute, 1);
+            glEnableVertexAttribArray(attribute);
+        }
+    }
+    void load_coords(const std::vector<glm::vec3>& vertices, GeometryCache* cache = nullptr) { // Загрузка координат вершин в видеопамять (VBO).
+        verteces_count = vertices.size();
+        quantized = false;
+        if (keepCpuGeometry()) {
+            cpu.vertices.resize(vertices.size());
+            for (size_t i = 0; i < vertices.size(); ++i) cpu.vertices[i].position = vertices[i];
+        }
+        vao.bind();
+        upload(vertexBuffer, GL_ARRAY_BUFFER, vertices.data(), vertices.size() * sizeof(glm::vec3), cache);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+        glEnableVertexAttribArray(0);
+    }
+    void load_colors(const std::vector<glm::vec3>& colors, GeometryCache* cache = nullptr) { // Загрузка цветов вершин в видеопамять (VBO).
+        if (keepCpuGeometry()) {
+            cpu.vertices.resize(std::max(cpu.vertices.size(), colors.size()));
+            for (size_t i = 0; i < colors.size(); ++i) cpu.vertices[i].color = colors[i];
+        }
+        vao.bind();
+        upload(colorBuffer, GL_ARRAY_BUFFER, colors.data(), colors.size() * sizeof(glm::vec3), cache);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+        glEnableVertexAttribArray(1);
+    }
+    // Загрузка координат и цветов одним вызовом glBufferData в выбранном формате. Сжатые форматы хранят позиции
+    // в ограничивающем кубе модели, приведенном к [-1, 1], и восстанавливаются в шейдере через positionTransform.
+    void load_vertices(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& colors, VertexLayout layout = VertexLayout::Interleaved, GeometryCache* cache = nullptr) {
+        if (layout == VertexLayout::Split) { load_coords(vertices, cache); load_colors(colors, cache); return; }
+        verteces_count = vertices.size();
+        colorBuffer.reset(); // Цвета хранятся в том же буфере, что и координаты.
+        quantized = isCompactLayout(layout);
+        if (keepCpuGeometry()) { // Растеризатор получает исходные позиции без сжатия.
+            cpu.vertices.resize(vertices.size());
+            for (size_t i = 0; i < vertices.size(); ++i) cpu.vertices[i] = { vertices[i], colors[i] };
+        }
+        if (quantized) positionTransform = quantizationTransform(vertices);
+        std::vector<uint8_t> data(vertices.size() * vertexStride(layout));
+        packVertices(vertices, colors, layout, positionTransform, data.data());
+        vao.bind();
+        upload(vertexBuffer, GL_ARRAY_BUFFER, data.data(), data.size(), cache);
+        setVertexFormat(layout);
+    }
+    // Загрузка сетки из открытого двоичного файла (mesh_file.h). Вершины и индексы передаются в glBufferData
+    // прямо из отображения файла, без промежуточных массивов и без разбора; формат вершин и тип индексов берутся
+    // из заголовка. Порядок индексов не оптимизируется и на мешлеты не делится (это делает конвертер при записи).
+    // Рисовать нужно примитивом file.header().primitive.
+    void load_file(const MeshFile& file, GeometryCache* cache = nullptr) {
+        const MeshFileHeader& header = file.header();
+        VertexLayout layout = file.layout();
+        verteces_count = (size_t)header.vertexCount;
+        colorBuffer.reset();
+        quantized = isCompactLayout(layout);
+        positionTransform = file.transform();
+        indices_count = (size_t)header.indexCount;
+        indexType = header.indexType;
+        meshlets = MultiDrawBatch();
+        indexStats = IndexOrderStats();
+        if (header.primitive == GL_TRIANGLES) indexStats.triangles = indices_count ? indices_count / 3 : verteces_count / 3;
+        if (keepCpuGeometry()) { // Растеризатору нужны распакованные вершины и 32-битные индексы.
+            const uint8_t* vertex = static_cast<const uint8_t*>(file.vertices());
+            cpu.vertices.resize(verteces_count);
+            for (size_t i = 0; i < verteces_count; ++i) cpu.vertices[i] = unpackVertex(vertex + i * header.vertexStride, layout, positionTransform);
+            cpu.indices = unpackIndices(file.indices(), indices_count, indexType);
+        }
+        vao.bind();
+        upload(vertexBuffer, GL_ARRAY_BUFFER, file.vertices(), (size_t)header.vertexBytes, cache);
+        setVertexFormat(layout);
+        if (indices_count > 0) upload(indexBuffer, GL_ELEMENT_ARRAY_BUFFER, file.indices(), (size_t)header.indexBytes, cache);
+        else indexBuffer.reset();
+    }
+    // Запись вершин текущего кадра в потоковый буфер без повторного выделения памяти (для анимированной геометрии).
+    // Вызывается каждый кадр между stream.beginFrame() и отправкой очереди. Возвращает false, если не хватило места.
+    bool stream_vertices(StreamBuffer& stream, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& colors) {
+        size_t offset = 0;
+        InterleavedVertex* data = static_cast<InterleavedVertex*>(stream.allocate(vertices.size() * sizeof(InterleavedVertex), offset));
+        if (!data) return false;
+        for (size_t i = 0; i < vertices.size(); ++i) data[i] = { vertices[i], colors[i] };
+        stream.unmap();
+        if (keepCpuGeometry()) { // Отображенную память после unmap читать нельзя, копия собирается заново.
+            cpu.vertices.resize(vertices.size());
+            for (size_t i = 0; i < vertices.size(); ++i) cpu.vertices[i] = { vertices[i], colors[i] };
+        }
+        verteces_count = vertices.size();
+        quantized = false;
+        vertexBuffer.reset(); colorBuffer.reset(); // Данные теперь берутся из потокового буфера.
+        vao.bind();
+        glBindBuffer(GL_ARRAY_BUFFER, stream.get());
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(InterleavedVertex), (void*)(offset + offsetof(InterleavedVertex, position)));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(InterleavedVertex), (void*)(offset + offsetof(InterleavedVertex, color)));
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        return true;
+    }
+    // Загрузка индексов вершин для оптимизированной отрисовки (EBO); mode - примитив, которым модель будет рисоваться.
+    // Для списка треугольников (GL_TRIANGLES) запоминается ACMR, а при optimize треугольники перед загрузкой
+    // переупорядочиваются для кэша вершин. Индексы хранятся в самом узком типе (8, 16 или 32 бита); список треугольников
+    // больше чем на 64k вершин делится на мешлеты с 16-битными индексами, если порядок вершин достаточно локален.
+    // Полосы, вееры и линии не переупорядочиваются и не делятся на мешлеты: если индексы не помещаются в 16 бит, остаются 32-битные.
+    void load_indices(GLenum mode, const std::vector<GLuint>& indices, GeometryCache* cache = nullptr, bool optimize = false) {
+        indices_count = indices.size();
+        indexStats = IndexOrderStats();
+        bool triangleList = mode == GL_TRIANGLES && indices.size() % 3 == 0;
+        if (triangleList) {
+            indexStats.triangles = indices.size() / 3;
+            indexStats.acmrBefore = indexStats.acmrAfter = computeACMR(indices);
+        }
+        std::vector<GLuint> reordered;
+        if (optimize && triangleList && indexStats.acmrBefore > 0.0) {
+            size_t vertexCount = std::max(verteces_count, (size_t)*std::max_element(indices.begin(), indices.end()) + 1);
+            reordered = optimizeVertexCache(indices, vertexCount);
+            indexStats.acmrAfter = computeACMR(reordered);
+            indexStats.optimized = true;
+        }
+        const std::vector<GLuint>& data = reordered.empty() ? indices : reordered;
+        indexType = narrowIndices ? indexTypeFor(maxVertexIndex(data)) : GL_UNSIGNED_INT;
+        meshlets = MultiDrawBatch();
+        std::vector<uint8_t> packed;
+        if (narrowIndices && indexType == GL_UNSIGNED_INT && triangleList && indexStats.acmrBefore > 0.0) { // 0 - есть перезапуски примитива.
+            std::vector<Meshlet> parts = splitMeshlets(data);
+            if (parts.size() <= 1 + data.size() / 3 / 4096) { // При случайном порядке вершин мешлеты слишком мелкие: остаются 32-битные индексы.
+                indexType = GL_UNSIGNED_SHORT;
+                packed.reserve(data.size() * sizeof(uint16_t));
+                for (const Meshlet& m : parts) {
+                    std::vector<uint8_t> part = packIndices(data.data() + m.firstIndex, m.indexCount, indexType, m.baseVertex);
+                    packed.insert(packed.end(), part.begin(), part.end());
+                    meshlets.counts.push_back((GLsizei)m.indexCount);
+                    meshlets.offsets.push_back((const void*)(m.firstIndex * sizeof(uint16_t)));
+                    meshlets.baseVertices.push_back(m.baseVertex);
+                }
+                meshlets.drawCount = (GLsizei)parts.size();
+            }
+        }
+        if (meshlets.drawCount == 0) packed = packIndices(data.data(), data.size(), indexType);
+        if (keepCpuGeometry()) { // Индексы мешлетов хранятся относительно их базовой вершины, как в видеопамяти.
+            cpu.indices = data;
+            for (GLsizei m = 0; m < meshlets.drawCount; ++m) {
+                size_t first = (size_t)meshlets.offsets[m] / sizeof(uint16_t);
+                for (size_t i = first; i < first + (size_t)meshlets.counts[m]; ++i) cpu.indices[i] -= (GLuint)meshlets.baseVertices[m];
+            }
+        }
+        vao.bind();
+        upload(indexBuffer, GL_ELEMENT_ARRAY_BUFFER, packed.data(), packed.size(), cache);
+    }
+    const IndexOrderStats& index_stats() const { return indexStats; }
+    GLenum index_type() const { return indexType; }
+    size_t index_bytes() const { return indices_count * indexSize(indexType); } // Размер буфера индексов в видеопамяти.
+    size_t meshlet_count() const { return (size_t)meshlets.drawCount; }
+    const char* get_name() const { return name; }
+    void setShaderProgram(GLuint programID) { shaderProgramID = programID; } // Установка шейдерной программы для использования этой моделью.
+    void setName(const char* modelName) { name = modelName; }
+    void setIndexNarrowing(bool enabled) { narrowIndices = enabled; } // Действует на следующие вызовы load_indices.
+};
+
+// Настройки сцены, которые меняются вводом. В оконном режиме ими владеет поток симуляции,
+// а поток отрисовки получает их копию из последнего снимка.
+struct SceneSettings {
+    int currentTask = 1;
+    float pointSmoothSize = 20.0f;
+    float lineWidth = 4.0f;
+    Task5Mode task5Mode = Task5Mode::Triangles;
+    Task8Mode task8Mode = Task8Mode::Vertices;
+    ToningMode toningMode = ToningMode::Flat;
+    LineJoin lineJoin = LineJoin::Miter; // Соединения толстых линий в заданиях 2-4.
+};
+
+// Состояние потока симуляции: настройки сцены и удержание клавиш.
+struct SimState {
+    SceneSettings scene;
+    bool keyUpHeld = false, keyDownHeld = false;
+    float keyHoldTimeUp = 0.0f;
+    float keyHoldTimeDown = 0.0f;
+    int lastPrintedPointSize = 0;
+    int lastPrintedLineWidth = 0;
+    unsigned long revision = 0; // Номер изменения scene: главный поток перерисовывает кадр, когда он меняется.
+};
+
+// Событие клавиатуры, передаваемое из главного потока (GLFW) в поток симуляции.
+struct InputEvent {
+    int key = 0;
+    int action = 0; // GLFW_PRESS или GLFW_RELEASE.
+};
+
+// Структура, хранящая все состояние приложения (настройки сцены - копия последнего снимка симуляции).
+struct AppState : SceneSettings {
+    int winWidth = 800, winHeight = 800;
+    Model* task1And2 = nullptr, * task3 = nullptr, * task4 = nullptr, * task6 = nullptr;
+    Model* task4And5_triangles = nullptr, * task4And5_strip = nullptr; 
+    MeshArena* task4And5_fans = nullptr; // Все вееры 5-го задания в общем буфере, рисуются одним вызовом.
+    Model* task7And8_flat = nullptr, * task7And8_smooth = nullptr;
+    GLuint smoothShaderProgram = 0, flatShaderProgram = 0; // ID скомпилированных шейдерных программ.    
+    GLuint instancedShaderProgram = 0; // Программа для отрисовки экземпляров (Model::renderInstanced).
+    GLuint lineShaderProgram = 0; // Программа толстых линий (ThickPolyline).
+    GLuint pointShaderProgram = 0; // Программа сглаженных точек (точечные спрайты).
+    ThickPolyline* task2Line = nullptr, * task3Line = nullptr, * task4Line = nullptr; // Контуры заданий 2-4 без glLineWidth.
+    GeometryCache geometryCache; // Общие буферы вершин и индексов для моделей заданий.
+    ShaderCache shaderCache; // Скомпилированные шейдерные программы с сохранением на диск.
+    FrameProfiler profiler; // Время кадров по заданиям (клавиша [P] выводит сводку).
+    GpuTimer gpuTimer; // Время GPU по моделям (клавиша [G] выводит сводку).
+    FixedStepSimulation<SimState, InputEvent> simulation; // Обработка ввода с фиксированным шагом в отдельном потоке.
+    bool redraw = true; // Кадр нужно перерисовать в режиме по требованию (изменился размер окна, нажата клавиша).
+    FrameCapture* capture = nullptr; // Чтение отрисованных кадров (--capture, --golden), если оно включено.
+};
+
+// Параметры запуска, задаваемые аргументами командной строки.
+struct LaunchOptions {
+    bool headless = false; // Отрисовка во внеэкранный буфер без видимого окна (для замеров на CI).
+    int task = 0; // Задание для отрисовки в headless-режиме (0 - все задания по очереди).
+    int frames = 300; // Количество кадров на одно задание в headless-режиме.
+    bool benchLayout = false; // Замер скорости отрисовки для разных форматов вершин (VertexLayout).
+    bool checkLeaks = false; // Проверка, что перезагрузка геометрии не оставляет лишних объектов OpenGL.
+    bool benchQueue = false; // Замер отправки синтетической сцены из 10 000 моделей с сортировкой очереди и без нее.
+    bool benchMultiDraw = false; // Замер мультиотрисовки из общего буфера для 1k/10k/100k объектов.
+    bool benchInstancing = false; // Замер числа отрисованных экземпляров многоугольника в секунду.
+    bool benchStream = false; // Замер потоковой передачи 1M вершин за кадр и времени ожидания CPU.
+    bool benchMeshGen = false; // Замер генерации круга из 1M вершин.
+    bool benchTriangulator = false; // Замер триангуляции контуров из 1k/10k/100k вершин.
+    bool checkTriangulator = false; // Сравнение триангуляции фигур с составленными вручную индексами.
+    bool benchMeshOpt = false; // Замер оптимизации порядка индексов (ACMR, полосы, время отрисовки) на больших сетках.
+    bool benchIndexWidth = false; // Замер памяти и времени отрисовки 32-битных индексов против выбранных автоматически.
+    bool benchLines = false; // Замер ломаной из 100k отрезков: glLineWidth против толстых линий из четырехугольников.
+    bool benchPoints = false; // Замер сглаженных точек: GL_POINT_SMOOTH против точечных спрайтов при разных размерах.
+    bool software = false; // Отрисовка заданий программным растеризатором вместо OpenGL (результат в памяти, без вывода на экран).
+    bool benchRaster = false; // Замер программного растеризатора на 1, 2, 4... потоках (не требует OpenGL).
+    bool clearShaderCache = false; // Удалить сохраненные на диске шейдерные программы перед запуском.
+    bool checkGpuTimer = false; // Проверка, что чтение меток времени GPU не останавливает цикл кадров.
+    bool checkGLState = false; // Сверка счетчиков кэша состояния с настоящими вызовами OpenGL (GLCallCounter).
+    bool onDemand = true; // Перерисовка только при изменениях: ожидание событий вместо непрерывного опроса (--continuous отключает).
+    int swapInterval = 1; // Вертикальная синхронизация: 0 - выключена, 1 - каждый кадр, -1 - адаптивная (--vsync N).
+    double maxFps = 0.0; // Ограничение частоты кадров (0 - без ограничения, --fps-cap N).
+    bool benchIdle = false; // Замер загрузки CPU и числа пробуждений в простое при непрерывной перерисовке и по требованию.
+    std::string captureOutput; // Запись отрисованных кадров в файл (--capture FILE): .ppm, .y4m, иначе RGBA без заголовка.
+    std::string goldenFile; // Файл эталонных хэшей кадров заданий (--golden FILE): сравнение, а если файла нет - запись.
+    bool benchCapture = false; // Замер частоты кадров без чтения кадров, с чтением через кольцо PBO и синхронным glReadPixels.
+    std::string meshInput, meshOutput; // Перевод текстовой сетки в двоичный файл (--convert-mesh IN OUT), окно не создается.
+    VertexLayout meshLayout = VertexLayout::Interleaved; // Формат вершин двоичного файла сетки (--layout NAME).
+    bool benchMeshFile = false; // Замер загрузки сетки из 10M треугольников из массивов и из отображенного двоичного файла.
+    bool bench = false; // Прогон всех заданий по frames кадров с записью процентилей времени кадра в файл.
+    std::string benchOutput = "bench.csv"; // Файл с результатами --bench (.json - JSON, иначе CSV).
+};
+
+// Внеэкранный буфер кадра (FBO), в который идет отрисовка в headless-режиме.
+class OffscreenTarget {
+private:
+    GLuint fbo = 0, colorRbo = 0, depthRbo = 0; // ID буфера кадра и его цветового и глубинного рендербуферов.
+public:
+    ~OffscreenTarget() {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &colorRbo); glDeleteRenderbuffers(1, &depthRbo);
+    }
+    bool create(int w, int h) { // Создание FBO заданного размера, возвращает false, если он неполный.
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glGenRenderbuffers(1, &colorRbo);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorRbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRbo);
+        glGenRenderbuffers(1, &depthRbo);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRbo);
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+    void bind() { glBindFramebuffer(GL_FRAMEBUFFER, fbo); } // Направляет дальнейшую отрисовку в этот буфер.
+};
+
+// Счетчики главного цикла для сравнения режимов перерисовки.
+struct RenderLoopStats {
+    long frames = 0; // Отрисованных кадров.
+    long wakeups = 0; // Итераций главного цикла (выходов из опроса или ожидания событий).
+};
+
+// Привязка внеэкранного буфера размера окна для headless-режима и режимов замера (false - буфер неполный, ошибка выведена).
+inline bool bindOffscreen(AppState& state, OffscreenTarget& target) {
+    if (!target.create(state.winWidth, state.winHeight)) { std::cerr << "ERROR: offscreen framebuffer is incomplete\n"; return false; }
+    target.bind();
+    return true;
+}
+
+// Функции заданий (CG_2.cpp), которые используют и режимы замера (benchmarks.cpp).
+void renderScene(AppState& state);
+RenderLoopStats runRenderLoop(AppState& state, GLFWwindow* window, const LaunchOptions& options, double duration = 0.0);
+void captureFrame(AppState& state);
+TaskIndices buildTaskIndices();
+std::vector<glm::vec3> getRegularPolygonVerticesCoordinates(int n, double r = 0.8);
@@ -0,0 +1,129 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "spsc_queue.h"
+
+// Каналы сообщений. Сообщения одного канала (кроме General) выводятся не чаще раза в rateLimit секунд:
+// промежуточные значения пропускаются, а последнее выводится по истечении интервала.
+enum class LogChannel { General = 0, PointSize, LineWidth, Count };
+
+// Сообщение в очереди журнала (фиксированного размера, чтобы очередь не выделяла память).
+struct LogMessage {
+    LogChannel channel = LogChannel::General;
+    char text[120] = {};
+};
+
+// Журнал с выводом в фоновом потоке. post() только кладет сообщение в очередь без блокировок
+// и никогда не ждет вывода, поэтому медленный stdout (файл, удаленный терминал) не задерживает кадр или шаг симуляции.
+// Писать в журнал может только один поток (поток симуляции). Если очередь полна, сообщение отбрасывается.
+// Фоновый поток спит до следующего post(), а пока у канала есть отложенное сообщение - не дольше, чем до его вывода.
+class AsyncLog {
+private:
+    typedef std::chrono::steady_clock Clock;
+    SpscQueue<LogMessage, 1024> queue;
+    std::thread thread;
+    std::atomic<bool> running{ false };
+    std::mutex wakeMutex;
+    std::condition_variable wakeup;
+    std::atomic<bool> sleeping{ false }; // Поток ждет сообщения (post должен его разбудить).
+    std::ostream* out = &std::cout;
+    static const int Channels = (int)LogChannel::Count;
+    Clock::time_point lastPrint[Channels]; // Время последнего вывода канала (только фоновый поток).
+    LogMessage pending[Channels]; // Последнее отложенное сообщение канала.
+    long suppressed[Channels] = {}; // Сколько сообщений канала пропущено с последнего вывода.
+
+    void print(const LogMessage& message, int channel) {
+        *out << message.text;
+        if (suppressed[channel] > 1) *out << " (" << suppressed[channel] - 1 << " similar suppressed)";
+        *out << '\n';
+        suppressed[channel] = 0;
+        lastPrint[channel] = Clock::now();
+    }
+    bool drain(bool final) { // Вывод накопленных сообщений, возвращает true, если что-то было выведено.
+        bool printed = false;
+        LogMessage message;
+        Clock::time_point now = Clock::now();
+        std::chrono::duration<double> interval(rateLimit);
+        while (queue.pop(message)) {
+            int channel = (int)message.channel;
+            if (message.channel == LogChannel::General) { suppressed[channel] = 0; print(message, channel); printed = true; continue; }
+            suppressed[channel]++;
+            if (now - lastPrint[channel] >= interval) { print(message, channel); printed = true; }
+            else pending[channel] = message;
+        }
+        for (int channel = 1; channel < Channels; ++channel) { // Последнее значение канала выводится, когда интервал прошел.
+            if (suppressed[channel] == 0 || (!final && now - lastPrint[channel] < interval)) continue;
+            print(pending[channel], channel); printed = true;
+        }
+        return printed;
+    }
+    bool nextDeadline(Clock::time_point& deadline) const { // Ближайший вывод отложенного сообщения (false - таких нет).
+        bool found = false;
+        Clock::duration interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(rateLimit));
+        for (int channel = 1; channel < Channels; ++channel) {
+            if (suppressed[channel] == 0) continue;
+            Clock::time_point due = lastPrint[channel] + interval;
+            if (!found || due < deadline) deadline = due;
+            found = true;
+        }
+        return found;
+    }
+    void run() {
+        while (running.load(std::memory_order_acquire)) {
+            if (drain(false)) out->flush();
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            sleeping.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst); // Парный барьер в post: сообщение не будет пропущено.
+            auto ready = [&] { return !queue.empty() || !running.load(std::memory_order_acquire); };
+            Clock::time_point deadline;
+            if (nextDeadline(deadline)) wakeup.wait_until(lock, deadline, ready);
+            else wakeup.wait(lock, ready);
+            sleeping.store(false);
+            wakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (drain(true)) out->flush();
+    }
+public:
+    double rateLimit = 0.1; // Минимальный интервал между сообщениями одного канала в секундах.
+    std::atomic<long> dropped{ 0 }; // Сообщений, не поместившихся в очередь.
+    std::atomic<long> wakeups{ 0 }; // Пробуждений фонового потока.
+
+    AsyncLog() = default;
+    AsyncLog(const AsyncLog&) = delete;
+    AsyncLog& operator=(const AsyncLog&) = delete;
+    ~AsyncLog() { stop(); }
+
+    void start(std::ostream& stream = std::cout) {
+        if (thread.joinable()) return;
+        out = &stream;
+        running.store(true, std::memory_order_release);
+        thread = std::thread(&AsyncLog::run, this);
+    }
+    void stop() { // Выводит оставшиеся сообщения и останавливает поток.
+        running.store(false, std::memory_order_release);
+        { std::lock_guard<std::mutex> lock(wakeMutex); }
+        wakeup.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+    void post(LogChannel channel, const std::string& text) {
+        LogMessage message;
+        message.channel = channel;
+        size_t length = std::min(text.size(), sizeof(message.text) - 1);
+        memcpy(message.text, text.data(), length);
+        if (!queue.push(message)) { dropped.fetch_add(1, std::memory_order_relaxed); return; }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load()) { std::lock_guard<std::mutex> lock(wakeMutex); wakeup.notify_one(); }
+    }
+    void post(const std::string& text) { post(LogChannel::General, text); }
+};
+
+// Общий журнал приложения.
+inline AsyncLog& appLog() { static AsyncLog log; return log; }
@@ -0,0 +1,1035 @@
+﻿// Режимы замера и проверки: отрисовка во внеэкранный буфер, сравнение вариантов и вывод результатов.
+#include "benchmarks.h"
+
+// Функция сравнивает время отрисовки и пропускную способность выборки вершин для раздельного, чередующегося,
+// упакованного и сжатых (16-битные позиции) форматов на сетке из мелких треугольников.
+// Для сжатых форматов выводится наибольшая ошибка восстановленной позиции.
+int runLayoutBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    glState().viewport(0, 0, state.winWidth, state.winHeight);
+
+    const int gridSize = 400; // Сетка gridSize x gridSize квадратов, по 6 вершин на квадрат (без индексов).
+    const int iterations = 50;
+    std::vector<glm::vec3> vertices, colors;
+    vertices.reserve(gridSize * gridSize * 6); colors.reserve(gridSize * gridSize * 6);
+    float cell = 2.0f / gridSize;
+    for (int y = 0; y < gridSize; ++y) {
+        for (int x = 0; x < gridSize; ++x) {
+            glm::vec3 p0(-1.0f + x * cell, -1.0f + y * cell, 0.0f), p1 = p0 + glm::vec3(cell, 0, 0), p2 = p0 + glm::vec3(0, cell, 0), p3 = p0 + glm::vec3(cell, cell, 0);
+            glm::vec3 c((float)x / gridSize, (float)y / gridSize, 0.5f);
+            for (const glm::vec3& p : { p0, p1, p2, p2, p1, p3 }) { vertices.push_back(p); colors.push_back(c); }
+        }
+    }
+
+    std::cout << "Vertex layout benchmark: " << vertices.size() << " vertices, " << iterations << " draws, renderer " << glGetString(GL_RENDERER) << "\n";
+    const struct { VertexLayout layout; const char* name; size_t bytesPerVertex; } cases[] = {
+        { VertexLayout::Split, "split (2 VBO)", 2 * sizeof(glm::vec3) },
+        { VertexLayout::Interleaved, "interleaved", sizeof(InterleavedVertex) },
+        { VertexLayout::Packed, "packed RGBA8", sizeof(PackedVertex) },
+        { VertexLayout::HalfRGBA8, "half + RGBA8", sizeof(CompactVertex) },
+        { VertexLayout::HalfRGB10A2, "half + RGB10A2", sizeof(CompactVertex) },
+        { VertexLayout::Snorm16RGBA8, "snorm16 + RGBA8", sizeof(CompactVertex) },
+        { VertexLayout::Snorm16RGB10A2, "snorm16 + RGB10A2", sizeof(CompactVertex) } };
+    double baselineBandwidthTime = 0.0; // Время отрисовки чередующегося формата (24 байта) для сравнения.
+    for (const auto& c : cases) {
+        Model model;
+        model.load_vertices(vertices, colors, c.layout);
+        model.setShaderProgram(state.smoothShaderProgram);
+        model.render(GL_TRIANGLES); drawQueue().flush(); glFinish(); // Прогревочная отрисовка.
+        double start = glfwGetTime();
+        for (int i = 0; i < iterations; ++i) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            model.render(GL_TRIANGLES);
+            drawQueue().flush();
+        }
+        glFinish();
+        double elapsed = glfwGetTime() - start;
+        double bytes = (double)vertices.size() * c.bytesPerVertex * iterations;
+        if (c.layout == VertexLayout::Interleaved) baselineBandwidthTime = elapsed;
+        std::cout << "  " << std::left << std::setw(17) << c.name << std::right << ": " << std::setw(2) << c.bytesPerVertex << " B/vertex, "
+            << std::fixed << std::setprecision(3) << elapsed * 1000.0 / iterations << " ms/draw, "
+            << std::setprecision(2) << bytes / elapsed / 1e9 << " GB/s vertex fetch";
+        if (isCompactLayout(c.layout)) {
+            PositionTransform transform = quantizationTransform(vertices);
+            std::vector<CompactVertex> packed(vertices.size());
+            packCompactVertices(vertices, colors, c.layout, transform, packed.data());
+            float maxError = 0.0f;
+            for (size_t i = 0; i < vertices.size(); ++i) maxError = std::max(maxError, glm::length(unpackCompactPosition(packed[i], c.layout, transform) - vertices[i]));
+            std::cout << ", " << std::setprecision(1) << 100.0 * (1.0 - elapsed / baselineBandwidthTime) << "% faster than interleaved, max position error "
+                << std::scientific << std::setprecision(2) << maxError << std::fixed;
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
+
+// Функция многократно перезагружает геометрию модели (напрямую и через кэш) и проверяет, что число живых
+// объектов OpenGL не растет: каждые 1000 перезагрузок, пока модель жива (после освобождения неиспользуемых буферов
+// кэша), и после удаления модели. Иначе модель, копящая буферы до деструктора, прошла бы проверку.
+int runLeakCheck(AppState& state) {
+    const int reloads = 10000, sampleEvery = 1000;
+    long before = glObjectCounters().total();
+    std::vector<long> samples; // Живые объекты при живой модели.
+    {
+        Model model;
+        model.setShaderProgram(state.smoothShaderProgram);
+        for (int i = 0; i < reloads; ++i) {
+            int sides = 3 + i % 16; // Размер меняется, чтобы проверить и обновление на месте, и повторное выделение.
+            std::vector<glm::vec3> vertices = getRegularPolygonVerticesCoordinates(sides, 0.5 + 0.001 * (i % 100));
+            std::vector<glm::vec3> colors(vertices.size(), glm::vec3(0.8f));
+            std::vector<GLuint> indices;
+            for (int k = 0; k < sides; ++k) indices.push_back(k);
+            GeometryCache* cache = (i % 3 == 0) ? &state.geometryCache : nullptr;
+            model.load_vertices(vertices, colors, (i % 4 == 1) ? VertexLayout::Split : VertexLayout::Interleaved, cache);
+            model.load_indices(GL_TRIANGLE_FAN, indices, cache);
+            model.render(GL_TRIANGLE_FAN);
+            drawQueue().flush();
+            if (i % 100 == 0) state.geometryCache.releaseUnused();
+            if (i % sampleEvery == 0) samples.push_back(glObjectCounters().total());
+        }
+        glFinish();
+    }
+    state.geometryCache.releaseUnused();
+    long after = glObjectCounters().total();
+    std::cout << "Leak check: " << reloads << " reloads, live GL objects before " << before << ", after " << after << ", with the model loaded:";
+    for (long count : samples) std::cout << " " << count;
+    std::cout << "\n";
+    int result = 0;
+    for (size_t k = 1; k < samples.size(); ++k) {
+        if (samples[k] > samples[0]) { std::cerr << "ERROR: live GL objects grew from " << samples[0] << " to " << samples[k] << " after " << k * sampleEvery << " reloads\n"; result = 1; break; }
+    }
+    if (after != before) { std::cerr << "ERROR: " << after - before << " GL objects leaked\n"; result = 1; }
+    return result;
+}
+
+// Функция отрисовывает синтетическую сцену из 10 000 моделей со случайными программой, примитивом и режимом граней
+// и сравнивает отправку команд в порядке постановки с отправкой после сортировки по ключу состояния.
+int runDrawQueueBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    glState().viewport(0, 0, state.winWidth, state.winHeight);
+
+    const int modelCount = 10000, frames = 20;
+    const GLenum primitives[] = { GL_TRIANGLE_FAN, GL_LINE_LOOP, GL_POINTS };
+    const GLenum polygonModes[] = { GL_FILL, GL_LINE };
+    std::vector<Model> models(modelCount);
+    std::vector<GLenum> modelPrimitive(modelCount), modelPolygonMode(modelCount);
+    for (int i = 0; i < modelCount; ++i) {
+        int sides = 3 + i % 8; // Восемь разных фигур, их буферы общие через кэш геометрии.
+        std::vector<glm::vec3> vertices = getRegularPolygonVerticesCoordinates(sides, 0.05);
+        models[i].load_vertices(vertices, std::vector<glm::vec3>(vertices.size(), glm::vec3(0.8f)), VertexLayout::Interleaved, &state.geometryCache);
+        models[i].setShaderProgram(rand() % 2 ? state.smoothShaderProgram : state.flatShaderProgram);
+        modelPrimitive[i] = primitives[rand() % 3];
+        modelPolygonMode[i] = polygonModes[rand() % 2];
+    }
+
+    std::cout << "Draw queue benchmark: " << modelCount << " models, " << frames << " frames, renderer " << glGetString(GL_RENDERER) << "\n";
+    for (bool sorted : { false, true }) {
+        double submitTime = 0.0, frameTime = 0.0;
+        for (int frame = 0; frame <= frames; ++frame) { // Кадр 0 - прогревочный, в замер не входит.
+            double start = glfwGetTime();
+            glState().beginFrame();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (int i = 0; i < modelCount; ++i) {
+                drawQueue().state.polygonFront = drawQueue().state.polygonBack = modelPolygonMode[i];
+                models[i].render(modelPrimitive[i]);
+            }
+            drawQueue().flush(sorted);
+            double submitted = glfwGetTime();
+            glFinish();
+            if (frame == 0) continue;
+            submitTime += submitted - start;
+            frameTime += glfwGetTime() - start;
+        }
+        const DrawQueueStats& stats = drawQueue().lastFlush;
+        std::cout << "  " << (sorted ? "sorted  " : "unsorted") << ": " << std::fixed << std::setprecision(3)
+            << submitTime * 1000.0 / frames << " ms CPU submit, " << frameTime * 1000.0 / frames << " ms/frame, "
+            << stats.programSwitches << " program switches, " << stats.vaoSwitches << " VAO switches, GL state calls: "
+            << glState().current.issued << " issued, " << glState().current.elided << " elided\n";
+    }
+    drawQueue().state = DrawState();
+    return 0;
+}
+
+// Функция сравнивает отрисовку множества мелких объектов из общего буфера отдельными вызовами
+// glDrawElementsBaseVertex и одной командой мультиотрисовки для 1k, 10k и 100k объектов.
+int runMultiDrawBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    glState().viewport(0, 0, state.winWidth, state.winHeight);
+
+    const int frames = 10;
+    std::cout << "Multi-draw benchmark: " << frames << " frames, renderer " << glGetString(GL_RENDERER) << "\n";
+    for (int objectCount : { 1000, 10000, 100000 }) {
+        MeshArena arena;
+        for (int i = 0; i < objectCount; ++i) { // Мелкие многоугольники в случайных местах, каждый - отдельный меш.
+            int sides = 3 + i % 6;
+            glm::vec3 offset((rand() % 2000) / 1000.0f - 1.0f, (rand() % 2000) / 1000.0f - 1.0f, 0.0f);
+            std::vector<glm::vec3> vertices = getRegularPolygonVerticesCoordinates(sides, 0.01);
+            for (glm::vec3& v : vertices) v += offset;
+            std::vector<GLuint> indices;
+            for (int k = 1; k + 1 < sides; ++k) { indices.push_back(0); indices.push_back(k); indices.push_back(k + 1); }
+            arena.addMesh(arena.addVertices(vertices, std::vector<glm::vec3>(vertices.size(), glm::vec3(0.2f, 0.7f, 0.3f))), indices);
+        }
+        arena.upload();
+
+        for (bool multi : { false, true }) {
+            double submitTime = 0.0, frameTime = 0.0;
+            for (int frame = 0; frame <= frames; ++frame) { // Кадр 0 - прогревочный, в замер не входит.
+                double start = glfwGetTime();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                for (int i = 0; i < objectCount; ++i) arena.draw(i);
+                if (multi) { arena.submit(state.smoothShaderProgram, GL_TRIANGLES); drawQueue().flush(); }
+                else arena.submitSeparately(state.smoothShaderProgram, GL_TRIANGLES);
+                double submitted = glfwGetTime();
+                glFinish();
+                if (frame == 0) continue;
+                submitTime += submitted - start;
+                frameTime += glfwGetTime() - start;
+            }
+            std::cout << "  " << std::setw(6) << objectCount << " objects, " << (multi ? (arena.usesIndirect() ? "multi-draw indirect" : "multi-draw base vertex") : "separate draws")
+                << ": " << (multi ? 1 : objectCount) << " draw calls, " << std::fixed << std::setprecision(3)
+                << submitTime * 1000.0 / frames << " ms CPU submit, " << frameTime * 1000.0 / frames << " ms/frame\n";
+        }
+    }
+    return 0;
+}
+
+// Функция рисует правильный многоугольник из 1-го задания в виде множества экземпляров одним вызовом
+// и выводит число экземпляров и треугольников в секунду.
+int runInstancingBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    glState().viewport(0, 0, state.winWidth, state.winHeight);
+
+    const int sides = 7, frames = 10;
+    std::vector<glm::vec3> polygon = getRegularPolygonVerticesCoordinates(sides);
+    Model model;
+    model.load_vertices(polygon, std::vector<glm::vec3>(polygon.size(), glm::vec3(1.0f)));
+    model.setShaderProgram(state.instancedShaderProgram);
+
+    std::cout << "Instancing benchmark: " << sides << "-gon, " << frames << " frames, renderer " << glGetString(GL_RENDERER) << "\n";
+    for (int count : { 1000, 10000, 100000, 1000000 }) {
+        std::vector<InstanceData> instances(count);
+        for (InstanceData& instance : instances) {
+            instance.offset = glm::vec3((rand() % 2000) / 1000.0f - 1.0f, (rand() % 2000) / 1000.0f - 1.0f, 0.0f);
+            instance.scale = 0.005f + (rand() % 100) / 10000.0f;
+            instance.color = glm::vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f);
+        }
+        model.load_instances(instances);
+        double elapsed = 0.0;
+        for (int frame = 0; frame <= frames; ++frame) { // Кадр 0 - прогревочный, в замер не входит.
+            double start = glfwGetTime();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            model.renderInstanced(GL_TRIANGLE_FAN, count);
+            drawQueue().flush();
+            glFinish();
+            if (frame > 0) elapsed += glfwGetTime() - start;
+        }
+        double perFrame = elapsed / frames;
+        std::cout << "  " << std::setw(7) << count << " instances: " << std::fixed << std::setprecision(3) << perFrame * 1000.0 << " ms/frame, "
+            << std::setprecision(2) << count / perFrame / 1e6 << " M instances/s, " << count * (sides - 2) / perFrame / 1e6 << " M triangles/s\n";
+    }
+    return 0;
+}
+
+// Функция каждый кадр пересчитывает и передает в видеопамять 1M вершин (волна из точек) через потоковый буфер
+// и выводит время записи, время кадра и время, которое CPU провел в ожидании GPU на fence.
+int runStreamingBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    glState().viewport(0, 0, state.winWidth, state.winHeight);
+
+    const int side = 1000, frames = 60; // Сетка side x side = 1M вершин.
+    std::vector<glm::vec3> vertices(side * side), colors(side * side);
+    StreamBuffer stream;
+    stream.create(vertices.size() * sizeof(InterleavedVertex) + 64);
+    Model model;
+    model.setShaderProgram(state.smoothShaderProgram);
+
+    std::cout << "Streaming benchmark: " << vertices.size() << " vertices/frame, " << frames << " frames, "
+        << (stream.isPersistent() ? "persistent mapping" : "orphaning") << ", renderer " << glGetString(GL_RENDERER) << "\n";
+    double writeTime = 0.0, frameTime = 0.0;
+    for (int frame = 0; frame < frames; ++frame) {
+        float t = frame * 0.05f;
+        for (int y = 0; y < side; ++y) {
+            for (int x = 0; x < side; ++x) {
+                float fx = x * 2.0f / side - 1.0f, fy = y * 2.0f / side - 1.0f;
+                float wave = 0.5f + 0.5f * std::sin(8.0f * fx + t) * std::cos(8.0f * fy - t);
+                vertices[y * side + x] = glm::vec3(fx, fy + 0.02f * wave, 0.0f);
+                colors[y * side + x] = glm::vec3(wave, 0.3f, 1.0f - wave);
+            }
+        }
+        double start = glfwGetTime();
+        stream.beginFrame();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (!model.stream_vertices(stream, vertices, colors)) { std::cerr << "ERROR: stream buffer is too small\n"; return -1; }
+        writeTime += glfwGetTime() - start;
+        model.render(GL_POINTS);
+        drawQueue().flush();
+        stream.endFrame();
+        glFlush();
+        frameTime += glfwGetTime() - start;
+    }
+    glFinish();
+    std::cout << "  " << std::fixed << std::setprecision(3) << writeTime * 1000.0 / frames << " ms/frame wait + write, "
+        << frameTime * 1000.0 / frames << " ms/frame CPU total, " << stream.waitSeconds * 1000.0 / frames << " ms/frame waiting on fences ("
+        << stream.waits << " of " << frames << " frames waited)\n";
+    return 0;
+}
+
+// Функция отрисовывает каждое задание по options.frames кадров во внеэкранный буфер, выводит процентили
+// времени CPU, GPU и полного кадра и записывает их в options.benchOutput для сравнения между сборками.
+int runTaskBenchmark(AppState& state, const LaunchOptions& options) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    std::string renderer = (const char*)glGetString(GL_RENDERER);
+    std::cout << "Task benchmark: " << options.frames << " frames per task, renderer " << renderer << "\n";
+
+    FrameProfiler& profiler = state.profiler;
+    profiler.reset();
+    profiler.historyLimit = std::max<size_t>(profiler.historyLimit, options.frames);
+    int firstTask = options.task ? options.task : 1, lastTask = options.task ? options.task : 8;
+    for (int task = firstTask; task <= lastTask; ++task) {
+        state.currentTask = task;
+        renderScene(state); glFinish(); // Прогревочный кадр не учитывается.
+        profiler.presented();
+        for (int frame = 0; frame < options.frames; ++frame) {
+            profiler.beginFrame(task);
+            renderScene(state);
+            profiler.endFrame(drawQueue().lastFlush.drawCalls);
+            glFinish(); // Кадр считается выведенным, когда GPU закончил отрисовку.
+            profiler.presented();
+            glfwPollEvents();
+        }
+    }
+    profiler.finish();
+    profiler.printSummary(std::cout);
+    if (!profiler.write(options.benchOutput, renderer)) { std::cerr << "ERROR: could not write " << options.benchOutput << "\n"; return -1; }
+    std::cout << "Results written to " << options.benchOutput << "\n";
+    return 0;
+}
+
+// Функция проверяет, что метки времени GPU читаются без ожидания. Кадры отправляются без glFinish,
+// а перед началом каждого кадра fence показывает, закончил ли GPU кадр, чьи метки сейчас будут прочитаны.
+// Если результаты получены для незаконченного кадра, значит чтение ждало GPU, и проверка не пройдена.
+int runGpuTimerCheck(AppState& state, const LaunchOptions& options) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    GpuTimer& timer = state.gpuTimer;
+    timer.reset();
+    drawQueue().timer = &timer;
+    timer.beginFrame();
+    if (!timer.isSupported()) { std::cout << "GPU timer queries are not supported, check skipped\n"; drawQueue().timer = nullptr; return 0; }
+
+    GLsync fences[GpuTimer::Frames] = {};
+    long frames = (long)options.frames * 8, stalls = 0;
+    double maxBegin = 0.0;
+    for (long frame = 0; frame < frames; ++frame) {
+        state.currentTask = (int)(frame % 8) + 1;
+        if (frame > 0) {
+            GLsync& fence = fences[frame % GpuTimer::Frames]; // Fence кадра, метки которого сейчас будут прочитаны.
+            bool finished = !fence || glClientWaitSync(fence, 0, 0) != GL_TIMEOUT_EXPIRED;
+            long resolved = timer.resolvedFrames;
+            double start = glfwGetTime();
+            timer.beginFrame();
+            maxBegin = std::max(maxBegin, glfwGetTime() - start);
+            if (!finished && timer.resolvedFrames > resolved) stalls++;
+        }
+        renderScene(state);
+        GLsync& fence = fences[frame % GpuTimer::Frames];
+        if (fence) glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+    glFinish();
+    for (GLsync fence : fences) if (fence) glDeleteSync(fence);
+    drawQueue().timer = nullptr;
+
+    timer.printSummary(std::cout);
+    std::cout << "Max time in GpuTimer::beginFrame: " << std::fixed << std::setprecision(3) << maxBegin * 1000.0 << " ms, "
+        << "reads of unfinished frames: " << stalls << "\n";
+    if (stalls > 0 || timer.resolvedFrames == 0) { std::cout << "FAILED\n"; return 1; }
+    std::cout << "OK: the frame loop never waited for query results\n";
+    return 0;
+}
+
+// Функция проверяет счетчики кэша состояния: пока установлен GLCallCounter, каждый кадр число настоящих вызовов
+// функций, которыми управляет кэш, должно совпасть с числом выполненных (issued) по счетчикам кэша.
+// Кадры идут по всем заданиям и режимам заданий 5 и 8 (frames кадров на каждый), чтобы состояние менялось.
+int runGLStateCheck(AppState& state, const LaunchOptions& options) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    std::cout << "GL state cache check: renderer " << drawQueue().backend->name() << "\n";
+
+    GLCallCounter counter;
+    counter.install();
+    long mismatches = 0, totalCalls = 0, totalIssued = 0, totalElided = 0;
+    int frames = std::min(options.frames, 10);
+    for (int task = 1; task <= 8; ++task) {
+        for (int mode = 1; mode <= 3; ++mode) {
+            if (mode > 1 && task != 5 && task != 8) break;
+            state.currentTask = task;
+            state.task5Mode = (Task5Mode)mode;
+            state.task8Mode = (Task8Mode)mode;
+            long calls = 0, issued = 0, elided = 0;
+            for (int frame = 0; frame < frames; ++frame) {
+                counter.calls = 0;
+                renderScene(state); // Счетчики кэша сбрасываются в начале кадра (RenderBackend::beginFrame).
+                if (counter.calls != glState().current.issued) mismatches++;
+                calls += counter.calls; issued += glState().current.issued; elided += glState().current.elided;
+            }
+            std::cout << "  task " << task << " mode " << mode << ": " << calls << " GL calls, cache " << issued << " issued, " << elided << " elided"
+                << (calls == issued ? "\n" : "  MISMATCH\n");
+            totalCalls += calls; totalIssued += issued; totalElided += elided;
+        }
+    }
+    counter.uninstall();
+    glFinish();
+    state.currentTask = 1;
+    state.task5Mode = Task5Mode::Triangles;
+    state.task8Mode = Task8Mode::Vertices;
+    std::cout << "Total: " << totalCalls << " GL calls, " << totalIssued << " issued, " << totalElided << " elided, " << mismatches << " frames differ\n";
+    if (mismatches > 0) { std::cout << "FAILED\n"; return 1; }
+    std::cout << "OK\n";
+    return 0;
+}
+
+// Функция сравнивает генерацию круга из 1M вершин вызовом sin/cos на каждую вершину, генератором с таблицей
+// точек окружности (в уже выделенную память) и повторным запросом из кэша генератора.
+int runMeshGeneratorBenchmark() {
+    const int segments = 1000, rings = 1000; // 1 + 1000 * 1000 вершин.
+    const int iterations = 10;
+    MeshData naive, generated;
+    double naiveTime = 0.0, generatorTime = 0.0;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        double start = glfwGetTime();
+        naive.clear();
+        naive.positions.push_back(glm::vec3(0.0f));
+        for (int ring = 1; ring <= rings; ++ring) {
+            double radius = 0.8 * ring / rings;
+            for (int i = 0; i < segments; ++i) {
+                double angle = 2.0 * M_PI * i / segments;
+                naive.positions.emplace_back((float)(radius * cos(angle)), (float)(radius * sin(angle)), 0.0f);
+            }
+        }
+        naiveTime += glfwGetTime() - start;
+
+        start = glfwGetTime();
+        generated.clear();
+        meshGenerator().disc(generated, segments, rings, 0.8f);
+        generatorTime += glfwGetTime() - start;
+    }
+    float maxError = 0.0f;
+    for (size_t i = 0; i < naive.positions.size(); ++i) maxError = std::max(maxError, glm::length(naive.positions[i] - generated.positions[i]));
+
+    double start = glfwGetTime();
+    meshGenerator().cached(MeshShape::Disc, segments, rings, 0.8f); // Первый запрос генерирует и запоминает.
+    double firstTime = glfwGetTime() - start;
+    start = glfwGetTime();
+    std::shared_ptr<const MeshData> disc = meshGenerator().cached(MeshShape::Disc, segments, rings, 0.8f);
+    double cachedTime = glfwGetTime() - start;
+
+    std::cout << "Mesh generator benchmark: disc with " << generated.positions.size() << " vertices, " << generated.indices.size() / 3 << " triangles\n"
+        << std::fixed << std::setprecision(3)
+        << "  sin/cos per vertex (positions only): " << naiveTime * 1000.0 / iterations << " ms\n"
+        << "  generator, reused storage          : " << generatorTime * 1000.0 / iterations << " ms (max deviation " << std::scientific << maxError << std::fixed << ")\n"
+        << "  cached(), first request            : " << firstTime * 1000.0 << " ms\n"
+        << "  cached(), repeated request         : " << cachedTime * 1000.0 << " ms (" << meshGenerator().hits << " hits, " << meshGenerator().misses << " misses)\n";
+    return disc->positions.size() == generated.positions.size() ? 0 : 1;
+}
+
+// Функция возвращает ориентированные площади треугольников: суммарную и сумму модулей (совпадают, если все
+// треугольники обходятся против часовой стрелки). Для полос индексы сначала разворачиваются в треугольники.
+void trianglesArea(const std::vector<glm::vec2>& points, const std::vector<GLuint>& indices, bool strip, double& area, double& absArea) {
+    std::vector<GLuint> triangles;
+    if (strip) {
+        size_t first = 0;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i] == PRIMITIVE_RESTART_INDEX) { first = i + 1; continue; }
+            size_t k = i - first;
+            if (k < 2) continue;
+            if (k % 2 == 0) triangles.insert(triangles.end(), { indices[i - 2], indices[i - 1], indices[i] });
+            else triangles.insert(triangles.end(), { indices[i - 1], indices[i - 2], indices[i] });
+        }
+    }
+    const std::vector<GLuint>& list = strip ? triangles : indices;
+    area = absArea = 0.0;
+    for (size_t t = 0; t + 2 < list.size(); t += 3) {
+        glm::dvec2 a(points[list[t]]), b(points[list[t + 1]]), c(points[list[t + 2]]);
+        double doubled = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        area += doubled / 2; absArea += std::abs(doubled) / 2;
+    }
+}
+
+// Функция возвращает площадь контура points[begin, end) по формуле шнурования.
+double outlineArea(const std::vector<glm::vec2>& points, size_t begin, size_t end) {
+    double doubled = 0.0;
+    for (size_t i = begin, j = end - 1; i < end; j = i++) doubled += (double)points[j].x * points[i].y - (double)points[i].x * points[j].y;
+    return std::abs(doubled) / 2;
+}
+
+// Функция строит контур-звезду из n вершин, радиус которой колеблется в пределах [1 - depth, 1] (невыпуклый при depth > 0).
+std::vector<glm::vec2> starOutline(int n, float depth) {
+    std::vector<glm::vec2> points(n);
+    const std::vector<glm::vec2>& circle = meshGenerator().circle(n);
+    for (int i = 0; i < n; ++i) points[i] = circle[i] * ((i % 2) ? 1.0f - depth : 1.0f);
+    return points;
+}
+
+// Функция проверяет триангуляцию: для фигур заданий результат сравнивается с составленными вручную индексами
+// (то же число треугольников, та же площадь, все треугольники против часовой стрелки), а также проверяются
+// контур с дырами, большие невыпуклые контуры и сборка полос и вееров. Для индексов, которые загружают модели заданий
+// (buildTaskIndices), проверяется, что они покрывают контур без перекрытий и что передних и задних граней
+// столько же, сколько в ручном списке (от этого зависит режим задания 8).
+int runTriangulatorCheck() {
+    int failures = 0;
+    auto report = [&](const std::string& name, bool ok, const std::string& details) {
+        std::cout << "  " << (ok ? "PASS " : "FAIL ") << std::left << std::setw(28) << name << std::right << details << "\n";
+        if (!ok) failures++;
+    };
+    auto near = [](double a, double b) { return std::abs(a - b) <= 1e-6 * std::max(1.0, std::abs(b)); };
+    auto flat = [](const std::vector<glm::vec3>& outline) {
+        std::vector<glm::vec2> points;
+        for (const glm::vec3& p : outline) points.push_back(glm::vec2(p));
+        return points;
+    };
+    std::cout << "Triangulator check:\n" << std::fixed << std::setprecision(6);
+
+    auto backFaces = [](const std::vector<glm::vec2>& points, const std::vector<GLuint>& indices) { // Треугольники по часовой стрелке.
+        int count = 0;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            glm::vec2 a = points[indices[t]], b = points[indices[t + 1]], c = points[indices[t + 2]];
+            if ((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x) < 0.0f) count++;
+        }
+        return count;
+    };
+
+    const TaskIndices taskIndices = buildTaskIndices();
+    // used - индексы, которые загружают модели заданий.
+    const struct { const char* name; const std::vector<glm::vec3>& outline; const std::vector<GLuint>& manual; const std::vector<GLuint>& used; } figures[] = {
+        { "figure 2 (tasks 4-5)", FIG2_VERTICES, FIG2_TRIANGLES_MANUAL, taskIndices.fig2Triangles },
+        { "figure 3 (tasks 7-8)", FIG3_VERTICES, FIG3_TRIANGLES_MANUAL, taskIndices.fig3Triangles } };
+    for (const auto& figure : figures) {
+        std::vector<glm::vec2> points = flat(figure.outline);
+        int usedBack = backFaces(points, figure.used), manualBack = backFaces(points, figure.manual);
+        report(std::string(figure.name) + " faces", figure.used.size() == figure.manual.size() && usedBack == manualBack,
+            std::to_string(figure.used.size() / 3 - usedBack) + " front, " + std::to_string(usedBack) + " back (manual " +
+            std::to_string(figure.manual.size() / 3 - manualBack) + " front, " + std::to_string(manualBack) + " back)");
+        double usedArea, usedAbs; // Без перекрытий и дыр сумма модулей площадей треугольников равна площади контура.
+        trianglesArea(points, figure.used, false, usedArea, usedAbs);
+        report(std::string(figure.name) + " coverage", near(usedAbs, outlineArea(points, 0, points.size())),
+            "area " + std::to_string(usedAbs) + " (outline " + std::to_string(outlineArea(points, 0, points.size())) + ")");
+        std::vector<GLuint> indices = triangulatePolygon(figure.outline);
+        double area, absArea, manualArea, manualAbs;
+        trianglesArea(points, indices, false, area, absArea);
+        trianglesArea(points, figure.manual, false, manualArea, manualAbs);
+        report(figure.name, indices.size() == figure.manual.size() && near(area, absArea) && near(absArea, manualAbs) && near(area, outlineArea(points, 0, points.size())),
+            std::to_string(indices.size() / 3) + " triangles (manual " + std::to_string(figure.manual.size() / 3) + "), area " + std::to_string(area) + " (manual " + std::to_string(manualAbs) + ")");
+        std::vector<GLuint> strips = trianglesToStrips(indices);
+        double stripArea, stripAbs;
+        trianglesArea(points, strips, true, stripArea, stripAbs);
+        report(std::string(figure.name) + " strips", near(stripArea, area) && near(stripAbs, absArea), std::to_string(strips.size()) + " indices");
+    }
+    {
+        std::vector<glm::vec2> points = flat(FIG2_VERTICES);
+        double manualStripArea, manualStripAbs, area, absArea;
+        trianglesArea(points, FIG2_STRIP_MANUAL, true, manualStripArea, manualStripAbs);
+        trianglesArea(points, taskIndices.fig2Strips, true, area, absArea);
+        report("figure 2 vs manual strip", near(absArea, manualStripAbs), "area " + std::to_string(absArea) + " (manual " + std::to_string(manualStripAbs) + ")");
+        auto fanTriangles = [](const std::vector<std::vector<GLuint>>& fans) { // Вееры в виде списка треугольников.
+            std::vector<GLuint> triangles;
+            for (const std::vector<GLuint>& fan : fans)
+                for (size_t i = 2; i < fan.size(); ++i) triangles.insert(triangles.end(), { fan[0], fan[i - 1], fan[i] });
+            return triangles;
+        };
+        double fanArea, fanAbs, manualFanArea, manualFanAbs;
+        trianglesArea(points, fanTriangles(taskIndices.fig2Fans), false, fanArea, fanAbs);
+        trianglesArea(points, fanTriangles(FIG2_FANS_MANUAL), false, manualFanArea, manualFanAbs);
+        report("figure 2 fans", near(fanArea, fanAbs) && near(fanAbs, manualFanAbs) && fanTriangles(taskIndices.fig2Fans).size() == taskIndices.fig2Triangles.size(),
+            std::to_string(taskIndices.fig2Fans.size()) + " fans (manual " + std::to_string(FIG2_FANS_MANUAL.size()) + "), area " + std::to_string(fanAbs) +
+            " (manual " + std::to_string(manualFanAbs) + ")");
+    }
+    { // Квадрат с двумя квадратными дырами (дыры обходятся в разные стороны).
+        std::vector<glm::vec2> points = { {0, 0}, {10, 0}, {10, 10}, {0, 10}, {2, 2}, {4, 2}, {4, 4}, {2, 4}, {6, 6}, {6, 8}, {8, 8}, {8, 6} };
+        std::vector<GLuint> indices;
+        Triangulator().triangulate(points, { 4, 8 }, indices);
+        double area, absArea;
+        trianglesArea(points, indices, false, area, absArea);
+        report("square with two holes", near(area, 92.0) && near(absArea, 92.0), std::to_string(indices.size() / 3) + " triangles, area " + std::to_string(area) + " (expected 92)");
+    }
+    for (int n : { 100, 1000, 10000 }) { // Невыпуклые контуры: площадь триангуляции равна площади контура, без перекрытий.
+        std::vector<glm::vec2> points = starOutline(n, 0.3f);
+        std::vector<GLuint> indices;
+        size_t count = Triangulator().triangulate(points, {}, indices);
+        double area, absArea;
+        trianglesArea(points, indices, false, area, absArea);
+        report("star outline, " + std::to_string(n) + " vertices", count == (size_t)n - 2 && near(area, absArea) && near(area, outlineArea(points, 0, n)),
+            std::to_string(count) + " triangles, area " + std::to_string(area));
+    }
+    std::cout << (failures ? "FAILED\n" : "OK\n");
+    return failures ? 1 : 0;
+}
+
+// Функция замеряет время триангуляции выпуклого (круг) и невыпуклого (звезда) контуров из 1k, 10k и 100k вершин
+// и сборки полос из результата.
+int runTriangulatorBenchmark() {
+    std::cout << "Triangulator benchmark:\n" << std::fixed;
+    for (int n : { 1000, 10000, 100000 }) {
+        const struct { const char* name; std::vector<glm::vec2> points; } outlines[] = {
+            { "circle", starOutline(n, 0.0f) }, { "star", starOutline(n, 0.02f) } };
+        for (const auto& outline : outlines) {
+            std::vector<GLuint> indices;
+            indices.reserve(3 * (size_t)n);
+            Triangulator triangulator;
+            double start = glfwGetTime();
+            size_t count = triangulator.triangulate(outline.points, {}, indices);
+            double triangulateTime = glfwGetTime() - start;
+            start = glfwGetTime();
+            std::vector<GLuint> strips = trianglesToStrips(indices);
+            double stripTime = glfwGetTime() - start;
+            size_t restarts = std::count(strips.begin(), strips.end(), PRIMITIVE_RESTART_INDEX);
+            std::cout << "  " << std::left << std::setw(7) << outline.name << std::right << std::setw(7) << n << " vertices: "
+                << std::setprecision(2) << triangulateTime * 1000.0 << " ms, " << std::setprecision(1) << count / triangulateTime / 1e6 << " M triangles/s; strips "
+                << std::setprecision(2) << stripTime * 1000.0 << " ms, " << strips.size() << " indices (" << restarts + 1 << " strips)\n";
+        }
+    }
+    return 0;
+}
+
+// Функция сравнивает порядок индексов больших сеток до и после оптимизации: ACMR, время оптимизации,
+// длину полос из оптимизированного порядка и время отрисовки исходного и оптимизированного (кэш + выборка вершин) буферов.
+// Каждая сетка проверяется в порядке генератора и с перемешанными треугольниками (худший случай).
+int runMeshOptimizerBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    glState().viewport(0, 0, state.winWidth, state.winHeight);
+
+    const int iterations = 20;
+    auto drawTime = [&](Model& model) { // Среднее время отрисовки модели в мс.
+        model.render(GL_TRIANGLES); drawQueue().flush(); glFinish(); // Прогревочная отрисовка.
+        double start = glfwGetTime();
+        for (int i = 0; i < iterations; ++i) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            model.render(GL_TRIANGLES);
+            drawQueue().flush();
+        }
+        glFinish();
+        return (glfwGetTime() - start) * 1000.0 / iterations;
+    };
+
+    MeshData star;
+    for (const glm::vec2& p : starOutline(100000, 0.02f)) star.positions.push_back(glm::vec3(0.8f * p, 0.0f));
+    Triangulator().triangulate(starOutline(100000, 0.02f), {}, star.indices);
+    const struct { const char* name; std::shared_ptr<const MeshData> mesh; } meshes[] = {
+        { "grid 512x512", meshGenerator().cached(MeshShape::Grid, 512, 512, 1.6f, 1.6f) },
+        { "disc 1000x1000", meshGenerator().cached(MeshShape::Disc, 1000, 1000, 0.8f) },
+        { "sphere 256x256", meshGenerator().cached(MeshShape::Sphere, 256, 256, 0.8f) },
+        { "torus 512x64", meshGenerator().cached(MeshShape::Torus, 512, 64, 0.6f, 0.2f) },
+        { "star 100k", std::make_shared<MeshData>(star) } };
+
+    std::cout << "Mesh optimizer benchmark: FIFO cache of " << VERTEX_CACHE_SIZE << ", " << iterations << " draws, renderer " << glGetString(GL_RENDERER) << "\n";
+    for (const auto& entry : meshes) {
+        const MeshData& mesh = *entry.mesh;
+        std::vector<glm::vec3> colors(mesh.positions.size());
+        for (size_t i = 0; i < colors.size(); ++i) colors[i] = glm::vec3((float)(i % 256) / 255.0f, 0.5f, 0.5f);
+        for (bool shuffled : { false, true }) {
+            std::vector<GLuint> indices = mesh.indices;
+            if (shuffled) { // Перемешивание треугольников (вершины внутри треугольника не меняются).
+                for (size_t t = indices.size() / 3; t > 1; --t) {
+                    size_t other = (((size_t)rand() << 15) ^ (size_t)rand()) % t;
+                    std::swap_ranges(indices.begin() + 3 * (t - 1), indices.begin() + 3 * t, indices.begin() + 3 * other);
+                }
+            }
+            double start = glfwGetTime();
+            std::vector<GLuint> optimized = optimizeVertexCache(indices, mesh.positions.size());
+            double optimizeTime = glfwGetTime() - start;
+            std::vector<GLuint> strips = trianglesToStrips(optimized);
+
+            Model original, reordered;
+            original.load_vertices(mesh.positions, colors);
+            original.load_indices(GL_TRIANGLES, indices);
+            original.setShaderProgram(state.smoothShaderProgram);
+            std::vector<glm::vec3> positions = mesh.positions, remappedColors = colors; // Вершины в порядке первого использования.
+            std::vector<GLuint> remap = optimizeVertexFetch(optimized, positions.size());
+            remapVertices(positions, remap); remapVertices(remappedColors, remap);
+            reordered.load_vertices(positions, remappedColors);
+            reordered.load_indices(GL_TRIANGLES, optimized);
+            reordered.setShaderProgram(state.smoothShaderProgram);
+
+            std::cout << "  " << std::left << std::setw(15) << entry.name << (shuffled ? " shuffled" : "         ") << std::right << std::setw(8) << indices.size() / 3
+                << " triangles: ACMR " << std::fixed << std::setprecision(3) << original.index_stats().acmrBefore << " -> " << reordered.index_stats().acmrBefore
+                << std::setprecision(1) << " (" << optimizeTime * 1000.0 << " ms), strips " << strips.size() << " indices vs " << indices.size()
+                << ", draw " << std::setprecision(3) << drawTime(original) << " -> " << drawTime(reordered) << " ms\n";
+        }
+    }
+    return 0;
+}
+
+// Функция сравнивает для фигур разного размера 32-битные индексы с выбранными автоматически
+// (8/16 бит или мешлеты с 16-битными индексами): размер буфера индексов и время отрисовки.
+int runIndexWidthBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+    glState().viewport(0, 0, state.winWidth, state.winHeight);
+
+    const int iterations = 50;
+    auto drawTime = [&](Model& model) { // Среднее время отрисовки модели в мс.
+        model.render(GL_TRIANGLES); drawQueue().flush(); glFinish(); // Прогревочная отрисовка.
+        double start = glfwGetTime();
+        for (int i = 0; i < iterations; ++i) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            model.render(GL_TRIANGLES);
+            drawQueue().flush();
+        }
+        glFinish();
+        return (glfwGetTime() - start) * 1000.0 / iterations;
+    };
+    auto typeName = [](GLenum type) { return type == GL_UNSIGNED_BYTE ? "uint8" : type == GL_UNSIGNED_SHORT ? "uint16" : "uint32"; };
+
+    MeshData figure;
+    figure.positions = FIG2_VERTICES;
+    figure.indices = buildTaskIndices().fig2Triangles;
+    const struct { const char* name; std::shared_ptr<const MeshData> mesh; } meshes[] = {
+        { "figure 2", std::make_shared<MeshData>(figure) },
+        { "sphere 64x32", meshGenerator().cached(MeshShape::Sphere, 64, 32, 0.8f) },
+        { "grid 512x512", meshGenerator().cached(MeshShape::Grid, 512, 512, 1.6f, 1.6f) },
+        { "disc 1000x1000", meshGenerator().cached(MeshShape::Disc, 1000, 1000, 0.8f) } };
+
+    std::cout << "Index width benchmark: " << iterations << " draws, renderer " << glGetString(GL_RENDERER) << "\n";
+    for (const auto& entry : meshes) {
+        const MeshData& mesh = *entry.mesh;
+        std::vector<glm::vec3> colors(mesh.positions.size(), glm::vec3(0.8f));
+        Model wide, narrow;
+        wide.setIndexNarrowing(false);
+        for (Model* model : { &wide, &narrow }) {
+            model->load_vertices(mesh.positions, colors);
+            model->load_indices(GL_TRIANGLES, mesh.indices);
+            model->setShaderProgram(state.smoothShaderProgram);
+        }
+        std::cout << "  " << std::left << std::setw(15) << entry.name << std::right << std::setw(8) << mesh.positions.size() << " vertices: uint32 "
+            << wide.index_bytes() << " B -> " << typeName(narrow.index_type()) << " " << narrow.index_bytes() << " B";
+        if (narrow.meshlet_count() > 0) std::cout << " in " << narrow.meshlet_count() << " meshlets";
+        std::cout << ", draw " << std::fixed << std::setprecision(3) << drawTime(wide) << " -> " << drawTime(narrow) << " ms\n";
+    }
+    return 0;
+}
+
+// Функция замеряет программный растеризатор на круге из ~200k треугольников (800x800) в режимах заливки
+// с гладким и плоским закрашиванием, каркаса и сглаженных точек при 1, 2, 4... потоках вплоть до числа ядер.
+// Изображение при любом числе потоков должно совпадать побайтно (сравниваются хэши кадров).
+int runRasterizerBenchmark() {
+    const int size = 800, iterations = 10;
+    const GLuint smoothProgram = 1, flatProgram = 2; // Условные ID программ: растеризатору нужен только способ закрашивания.
+    MeshData disc;
+    meshGenerator().disc(disc, 500, 200, 0.95f); // 500 * (1 + 2 * 199) = 199 500 треугольников.
+    CpuMesh mesh;
+    mesh.indices = disc.indices;
+    for (const glm::vec3& p : disc.positions) mesh.vertices.push_back({ p, glm::vec3(0.5f + 0.5f * p.x, 0.5f + 0.5f * p.y, 0.5f) });
+    size_t triangles = disc.indices.size() / 3;
+
+    struct Scene { const char* name; GLuint program; GLenum mode; DrawState state; };
+    DrawState fill, wire, points;
+    wire.polygonFront = wire.polygonBack = GL_LINE;
+    points.polygonFront = points.polygonBack = GL_POINT;
+    points.pointSize = 3.0f; points.pointSmooth = true;
+    const Scene scenes[] = {
+        { "fill, smooth", smoothProgram, GL_TRIANGLES, fill },
+        { "fill, flat", flatProgram, GL_TRIANGLES, fill },
+        { "wireframe", smoothProgram, GL_TRIANGLES, wire },
+        { "smooth points", smoothProgram, GL_TRIANGLES, points },
+    };
+    std::vector<int> threadCounts;
+    int cores = (int)std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads < cores; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    std::cout << "Software rasterizer benchmark: disc with " << mesh.vertices.size() << " vertices, " << triangles << " triangles, "
+        << size << "x" << size << ", " << cores << " hardware threads\n";
+    bool identical = true;
+    for (const Scene& scene : scenes) {
+        uint64_t reference = 0;
+        for (int threads : threadCounts) {
+            SoftwareRasterizer rasterizer(threads);
+            rasterizer.setShading(flatProgram, Shading::Flat);
+            DrawCommand command;
+            command.program = scene.program; command.mode = scene.mode; command.state = scene.state;
+            command.count = (GLsizei)mesh.indices.size(); command.indexType = GL_UNSIGNED_INT; command.mesh = &mesh;
+            auto frame = [&]() { rasterizer.beginFrame(size, size); rasterizer.draw(command); rasterizer.finish(); };
+            frame(); // Прогревочный кадр: выделение буферов кадра и списков плиток.
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) frame();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+            uint64_t hash = hashBytes(rasterizer.pixels().data(), rasterizer.pixels().size() * sizeof(uint32_t));
+            if (threads == threadCounts.front()) reference = hash;
+            bool same = hash == reference;
+            identical = identical && same;
+            double mtris = triangles / seconds / 1e6;
+            std::cout << "  " << std::left << std::setw(14) << scene.name << std::right << " " << std::setw(2) << threads << " threads: "
+                << std::fixed << std::setprecision(2) << std::setw(8) << seconds * 1000.0 << " ms/frame, "
+                << std::setw(6) << mtris << " Mtri/s, " << std::setw(6) << mtris / threads << " Mtri/s per thread"
+                << (same ? "" : " (IMAGE DIFFERS)") << "\n";
+        }
+    }
+    std::cout << (identical ? "  Images are identical for all thread counts\n" : "  ERROR: image depends on thread count\n");
+    return identical ? 0 : 1;
+}
+
+// Функция замеряет простой приложения без ввода: загрузку CPU (все потоки процесса), число пробуждений
+// главного цикла, потока симуляции и потока журнала в секунду при прежней непрерывной перерисовке, с ограничением частоты
+// кадров и в режиме перерисовки по требованию.
+int runIdleBenchmark(AppState& state, GLFWwindow* window, const LaunchOptions& options) {
+    const double seconds = 5.0;
+    struct Mode { const char* name; bool onDemand; double maxFps; bool simulationSleeps; };
+    const Mode modes[] = {
+        { "continuous (before)", false, 0.0, false },
+        { "continuous, 60 FPS cap", false, 60.0, true },
+        { "on demand", true, 0.0, true },
+    };
+    std::cout << "Idle benchmark: " << seconds << " s per mode without input, vsync " << options.swapInterval << "\n"
+        << "  mode                        CPU, % of core   frames/s   loop wakeups/s   simulation steps/s   simulation wakeups/s   log wakeups/s\n";
+    for (const Mode& mode : modes) {
+        LaunchOptions modeOptions = options;
+        modeOptions.onDemand = mode.onDemand;
+        modeOptions.maxFps = mode.maxFps;
+        state.simulation.sleepWhenIdle = mode.simulationSleeps;
+        state.simulation.post({ 0, GLFW_RELEASE }); // Будит поток симуляции, если он спит, чтобы применить новый режим.
+        runRenderLoop(state, window, modeOptions, 0.5); // Установившийся режим: первый кадр и пробуждения не учитываются.
+        long stepsBefore = state.simulation.steps, simulationWakeupsBefore = state.simulation.wakeups, logWakeupsBefore = appLog().wakeups;
+        double cpuBefore = processCpuSeconds(), start = glfwGetTime();
+        RenderLoopStats stats = runRenderLoop(state, window, modeOptions, seconds);
+        double elapsed = glfwGetTime() - start, cpu = processCpuSeconds() - cpuBefore;
+        long steps = state.simulation.steps - stepsBefore;
+        long simulationWakeups = state.simulation.wakeups - simulationWakeupsBefore, logWakeups = appLog().wakeups - logWakeupsBefore;
+        std::cout << "  " << std::left << std::setw(26) << mode.name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(16) << cpu / elapsed * 100.0 << std::setw(11) << stats.frames / elapsed
+            << std::setw(17) << stats.wakeups / elapsed << std::setw(21) << steps / elapsed
+            << std::setw(23) << simulationWakeups / elapsed << std::setw(16) << logWakeups / elapsed << "\n";
+        if (glfwWindowShouldClose(window)) break;
+    }
+    state.simulation.sleepWhenIdle = true;
+    return 0;
+}
+
+// Функция сравнивает ломаную из 100k отрезков, нарисованную линиями OpenGL с glLineWidth и толстыми линиями
+// ThickPolyline (соединения "митра" и скругленные), при толщине от 1 до 32 пикселей.
+// Драйвер может ограничивать glLineWidth (GL_ALIASED_LINE_WIDTH_RANGE), тогда широкие линии выходят тоньше заданного.
+int runLineBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+
+    const int segments = 100000, frames = 10;
+    std::vector<glm::vec3> points(segments + 1), colors(segments + 1);
+    for (int i = 0; i <= segments; ++i) { // Фигура Лиссажу: отрезки по нескольку пикселей с поворотами во все стороны.
+        float t = (float)i / segments * 2.0f * (float)M_PI;
+        points[i] = glm::vec3(0.9f * sinf(37.0f * t), 0.9f * sinf(41.0f * t + 0.5f), 0.0f);
+        colors[i] = glm::vec3(0.5f + 0.5f * sinf(3.0f * t), 0.5f + 0.5f * cosf(5.0f * t), 0.8f);
+    }
+    Model glLines;
+    glLines.load_vertices(points, colors);
+    glLines.setShaderProgram(state.smoothShaderProgram);
+    ThickPolyline thick;
+    thick.load(points, colors, false);
+    thick.setShaderProgram(state.lineShaderProgram);
+    GLfloat widthRange[2] = { 1.0f, 1.0f };
+    glGetFloatv(GL_ALIASED_LINE_WIDTH_RANGE, widthRange);
+
+    std::cout << "Line benchmark: polyline with " << segments << " segments, " << frames << " frames, renderer " << glGetString(GL_RENDERER)
+        << ", glLineWidth range " << widthRange[0] << "-" << widthRange[1] << "\n"
+        << "  width   glLineWidth ms   miter quads ms   round quads ms   (M segments/s)\n";
+    for (float width : { 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 32.0f }) {
+        auto drawTime = [&](auto render) {
+            double elapsed = 0.0;
+            for (int frame = 0; frame <= frames; ++frame) { // Кадр 0 - прогревочный, в замер не входит.
+                double start = glfwGetTime();
+                drawQueue().backend->beginFrame(state.winWidth, state.winHeight);
+                drawQueue().state = DrawState();
+                drawQueue().state.lineWidth = width;
+                render();
+                drawQueue().flush();
+                glFinish();
+                if (frame > 0) elapsed += glfwGetTime() - start;
+            }
+            return elapsed / frames;
+        };
+        double lineTime = drawTime([&] { glLines.render(GL_LINE_STRIP); });
+        double miterTime = drawTime([&] { drawQueue().state.lineJoin = LineJoin::Miter; thick.render(); });
+        double roundTime = drawTime([&] { drawQueue().state.lineJoin = LineJoin::Round; thick.render(); });
+        std::cout << std::fixed << std::setprecision(0) << std::setw(7) << width << std::setprecision(3);
+        for (double time : { lineTime, miterTime, roundTime })
+            std::cout << std::setw(9) << time * 1000.0 << " (" << std::setprecision(1) << std::setw(5) << segments / time / 1e6 << ")" << std::setprecision(3);
+        std::cout << (width > widthRange[1] ? "  glLineWidth clamped\n" : "\n");
+    }
+    drawQueue().state = DrawState();
+    return 0;
+}
+
+// Функция сравнивает сглаженные точки GL_POINT_SMOOTH (прежний путь задания 1) и точечные спрайты с
+// аналитическим сглаживанием для 100k, 1M и 4M точек размером от 1 до 64 пикселей. Оба варианта со смешиванием.
+int runPointBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+
+    const int frames = 5;
+    GLfloat sizeRange[2] = { 1.0f, 1.0f };
+    glGetFloatv(GL_POINT_SIZE_RANGE, sizeRange);
+    std::cout << "Point benchmark: " << frames << " frames, renderer " << glGetString(GL_RENDERER) << ", point size range "
+        << sizeRange[0] << "-" << sizeRange[1] << "\n"
+        << "   points  size   GL_POINT_SMOOTH ms (M points/s)   sprites ms (M points/s)\n";
+    Model model;
+    model.setName("points");
+    for (int count : { 100000, 1000000, 4000000 }) {
+        std::vector<glm::vec3> points(count), colors(count);
+        for (int i = 0; i < count; ++i) {
+            points[i] = glm::vec3((rand() % 2000) / 1000.0f - 1.0f, (rand() % 2000) / 1000.0f - 1.0f, 0.0f);
+            colors[i] = glm::vec3((rand() % 100) / 100.0f, (rand() % 100) / 100.0f, (rand() % 100) / 100.0f);
+        }
+        model.load_vertices(points, colors);
+        for (float size : { 1.0f, 4.0f, 16.0f, 64.0f }) {
+            auto drawTime = [&](GLuint program, bool legacy) {
+                model.setShaderProgram(program);
+                glState().setEnabled(GL_POINT_SMOOTH, legacy);
+                double elapsed = 0.0;
+                for (int frame = 0; frame <= frames; ++frame) { // Кадр 0 - прогревочный, в замер не входит.
+                    double start = glfwGetTime();
+                    drawQueue().backend->beginFrame(state.winWidth, state.winHeight);
+                    drawQueue().state = DrawState();
+                    drawQueue().state.pointSize = size;
+                    drawQueue().state.pointSmooth = drawQueue().state.blend = true;
+                    model.render(GL_POINTS);
+                    drawQueue().flush();
+                    glFinish();
+                    if (frame > 0) elapsed += glfwGetTime() - start;
+                }
+                glState().setEnabled(GL_POINT_SMOOTH, false);
+                return elapsed / frames;
+            };
+            double legacyTime = drawTime(state.smoothShaderProgram, true);
+            double spriteTime = drawTime(state.pointShaderProgram, false);
+            std::cout << std::setw(9) << count << std::fixed << std::setprecision(0) << std::setw(6) << size << std::setprecision(3)
+                << std::setw(21) << legacyTime * 1000.0 << " (" << std::setprecision(1) << std::setw(6) << count / legacyTime / 1e6 << ")"
+                << std::setprecision(3) << std::setw(15) << spriteTime * 1000.0 << " (" << std::setprecision(1) << std::setw(6) << count / spriteTime / 1e6 << ")\n";
+        }
+    }
+    drawQueue().state = DrawState();
+    return 0;
+}
+
+// Функция замеряет частоту кадров каждого задания при чтении кадров размером winWidth x winHeight:
+// без чтения, через кольцо PBO (только хэши, FrameCapture) и синхронным glReadPixels в память.
+// Кадры не ждут glFinish, как в окне с glfwSwapBuffers, поэтому синхронное чтение каждый раз останавливает конвейер.
+int runCaptureBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+
+    const int frames = 300;
+    int w = state.winWidth, h = state.winHeight;
+    std::vector<uint8_t> pixels((size_t)w * h * 4);
+    std::cout << "Capture benchmark: " << w << "x" << h << ", " << frames << " frames per task, ring of " << FrameCapture::RingSize
+        << " PBOs, renderer " << glGetString(GL_RENDERER) << "\n"
+        << "  task   no capture FPS   PBO ring FPS (drop, wait ms)   glReadPixels FPS (drop)\n";
+    for (int task = 1; task <= 8; ++task) {
+        state.currentTask = task;
+        FrameCapture capture;
+        auto fps = [&](int mode) { // 0 - без чтения, 1 - кольцо PBO, 2 - синхронное чтение.
+            if (mode == 1) { capture.start(""); state.capture = &capture; }
+            renderScene(state); captureFrame(state); glFinish(); // Прогревочный кадр.
+            double start = glfwGetTime();
+            for (int frame = 0; frame < frames; ++frame) {
+                renderScene(state);
+                if (mode == 1) captureFrame(state);
+                else if (mode == 2) { glPixelStorei(GL_PACK_ALIGNMENT, 1); glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()); }
+            }
+            if (mode == 1) { capture.stop(); state.capture = nullptr; }
+            glFinish();
+            return frames / (glfwGetTime() - start);
+        };
+        double plain = fps(0), ring = fps(1), sync = fps(2);
+        std::cout << std::setw(6) << task << std::fixed << std::setprecision(1) << std::setw(17) << plain
+            << std::setw(15) << ring << " (" << std::setw(5) << 100.0 * (1.0 - ring / plain) << "%, " << std::setprecision(2) << capture.waitSeconds * 1000.0 << ")"
+            << std::setprecision(1) << std::setw(19) << sync << " (" << std::setw(5) << 100.0 * (1.0 - sync / plain) << "%)\n";
+    }
+    return 0;
+}
+
+// Функция переводит текстовую сетку (формат описан у readTextMesh) в двоичный файл mesh_file.h.
+// Список треугольников перед записью переупорядочивается для кэша вершин, чтобы при загрузке это не делать.
+int runMeshConverter(const LaunchOptions& options) {
+    auto start = std::chrono::steady_clock::now();
+    TextMesh mesh;
+    if (!readTextMesh(options.meshInput, mesh)) return -1;
+    double acmrBefore = mesh.primitive == GL_TRIANGLES ? computeACMR(mesh.indices) : 0.0, acmrAfter = acmrBefore;
+    if (acmrBefore > 0.0) { // 0 - не список треугольников или есть перезапуски примитива.
+        mesh.indices = optimizeVertexCache(mesh.indices, mesh.positions.size());
+        acmrAfter = computeACMR(mesh.indices);
+    }
+    if (!writeMeshFile(options.meshOutput, mesh.positions, mesh.colors, mesh.indices, options.meshLayout, mesh.primitive)) return -1;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    GLenum indexType = indexTypeFor(maxVertexIndex(mesh.indices));
+    std::cout << "Converted " << options.meshInput << " -> " << options.meshOutput << ": " << mesh.positions.size() << " vertices ("
+        << vertexLayoutName(options.meshLayout == VertexLayout::Split ? VertexLayout::Interleaved : options.meshLayout) << "), "
+        << mesh.indices.size() << " indices (" << indexSize(indexType) * 8 << "-bit)";
+    if (acmrBefore > 0.0) std::cout << ", ACMR " << std::fixed << std::setprecision(3) << acmrBefore << " -> " << acmrAfter;
+    std::cout << ", " << std::fixed << std::setprecision(1) << elapsed * 1000.0 << " ms\n";
+    return 0;
+}
+
+// Функция замеряет загрузку сетки из 10M треугольников (5M вершин): из массивов через load_vertices и load_indices
+// и из двоичного файла через отображение в память (load_file) для обычного и сжатого форматов вершин.
+// Файл только что записан и лежит в кэше страниц ОС, поэтому время чтения с диска в замер не входит.
+// Для несжатого формата кадр с сеткой из файла сравнивается с кадром с сеткой из массивов.
+int runMeshFileBenchmark(AppState& state) {
+    OffscreenTarget target;
+    if (!bindOffscreen(state, target)) return -1;
+
+    const int cols = 2500, rows = 2000; // 2500 * 2000 * 2 = 10M треугольников.
+    const std::string path = "mesh_benchmark.cgm";
+    MeshData grid;
+    meshGenerator().grid(grid, cols, rows, 1.9f, 1.9f);
+    std::vector<glm::vec3> colors(grid.positions.size());
+    for (size_t i = 0; i < colors.size(); ++i) colors[i] = glm::vec3(0.5f + 0.5f * grid.positions[i].x, 0.5f + 0.5f * grid.positions[i].y, 0.5f);
+    std::cout << "Mesh file benchmark: " << grid.indices.size() / 3 << " triangles, " << grid.positions.size() << " vertices, renderer "
+        << glGetString(GL_RENDERER) << "\n";
+
+    Model model;
+    model.setShaderProgram(state.smoothShaderProgram);
+    auto seconds = [](auto body) { double start = glfwGetTime(); body(); glFinish(); return glfwGetTime() - start; };
+    std::vector<uint8_t> pixels((size_t)state.winWidth * state.winHeight * 4);
+    auto frameHash = [&](GLenum mode) { // Кадр с загруженной моделью.
+        drawQueue().backend->beginFrame(state.winWidth, state.winHeight);
+        drawQueue().state = DrawState();
+        model.render(mode);
+        drawQueue().flush();
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, state.winWidth, state.winHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return hashBytes(pixels.data(), pixels.size());
+    };
+    double vectorTime = seconds([&] { model.load_vertices(grid.positions, colors); model.load_indices(GL_TRIANGLES, grid.indices); });
+    uint64_t vectorHash = frameHash(GL_TRIANGLES);
+    std::cout << "  from vectors (interleaved)  : " << std::fixed << std::setprecision(1) << vectorTime * 1000.0 << " ms\n";
+
+    for (VertexLayout layout : { VertexLayout::Interleaved, VertexLayout::Snorm16RGBA8 }) {
+        bool written = false;
+        double writeTime = seconds([&] { written = writeMeshFile(path, grid.positions, colors, grid.indices, layout, GL_TRIANGLES); });
+        if (!written) return -1;
+        MeshFile file;
+        bool opened = false;
+        double mapTime = seconds([&] { opened = file.open(path); });
+        if (!opened) return -1;
+        double uploadTime = seconds([&] { model.load_file(file); });
+        double megabytes = file.fileSize() / 1048576.0;
+        GLenum primitive = file.header().primitive;
+        file.close();
+        uint64_t hash = frameHash(primitive);
+        std::cout << "  mmap file (" << std::left << std::setw(15) << vertexLayoutName(layout) << std::right << "): " << std::setprecision(1)
+            << megabytes << " MB, map " << std::setprecision(2) << mapTime * 1000.0 << " ms, upload " << std::setprecision(1) << uploadTime * 1000.0
+            << " ms (" << std::setprecision(2) << megabytes / 1024.0 / uploadTime << " GB/s), total " << std::setprecision(1) << (mapTime + uploadTime) * 1000.0
+            << " ms, " << std::setprecision(1) << vectorTime / (mapTime + uploadTime) << "x vs vectors; write " << writeTime * 1000.0 << " ms";
+        if (!isCompactLayout(layout)) std::cout << (hash == vectorHash ? ", image matches" : ", IMAGE DIFFERS");
+        std::cout << "\n";
+    }
+    std::remove(path.c_str());
+    drawQueue().state = DrawState();
+    return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "app.h"
+
+// Режимы замера и проверки (--bench-*, --check-*, --convert-mesh), которые main запускает вместо показа заданий.
+// Каждый режим выводит результаты в stdout и возвращает код завершения программы.
+int runLayoutBenchmark(AppState& state);
+int runLeakCheck(AppState& state);
+int runDrawQueueBenchmark(AppState& state);
+int runMultiDrawBenchmark(AppState& state);
+int runInstancingBenchmark(AppState& state);
+int runStreamingBenchmark(AppState& state);
+int runMeshGeneratorBenchmark();
+int runTriangulatorBenchmark();
+int runTriangulatorCheck();
+int runMeshOptimizerBenchmark(AppState& state);
+int runIndexWidthBenchmark(AppState& state);
+int runRasterizerBenchmark();
+int runLineBenchmark(AppState& state);
+int runPointBenchmark(AppState& state);
+int runTaskBenchmark(AppState& state, const LaunchOptions& options);
+int runGpuTimerCheck(AppState& state, const LaunchOptions& options);
+int runGLStateCheck(AppState& state, const LaunchOptions& options);
+int runIdleBenchmark(AppState& state, GLFWwindow* window, const LaunchOptions& options);
+int runCaptureBenchmark(AppState& state);
+int runMeshConverter(const LaunchOptions& options);
+int runMeshFileBenchmark(AppState& state);
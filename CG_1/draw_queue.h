@@ -0,0 +1,246 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "gl_state.h"
+#include "gpu_timer.h"
+#include "index_buffer.h"
+#include "vertex_format.h"
+
+// Соединения отрезков толстой линии (ThickPolyline): продолжение краев до пересечения или скругление.
+enum class LineJoin { Miter = 1, Round };
+
+// Состояние конвейера, которое фиксируется в команде отрисовки в момент ее постановки в очередь.
+struct DrawState {
+    GLenum polygonFront = GL_FILL, polygonBack = GL_FILL; // Режимы отображения лицевых и обратных граней.
+    GLfloat pointSize = 1.0f;
+    GLfloat lineWidth = 1.0f; // Толщина в пикселях: glLineWidth для линий OpenGL или uniform line_width для ThickPolyline.
+    LineJoin lineJoin = LineJoin::Miter; // Только для ThickPolyline (скругление также делает круглыми концы).
+    bool pointSmooth = false; // Сглаженные круглые точки: в OpenGL их рисует программа FRAGMENT_SHADER_POINT_SPRITE, программный растеризатор - сам.
+    bool blend = false; // Смешивание по альфе (только для проходов с полупрозрачными краями, например точечных спрайтов).
+};
+
+// Параметры команды glMultiDrawElementsIndirect (формат структуры задан спецификацией OpenGL).
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// Набор отрисовок из общего буфера индексов, выполняемый одним вызовом glMultiDrawElementsIndirect
+// (команды лежат в GL_DRAW_INDIRECT_BUFFER) или, без поддержки MDI, одним glMultiDrawElementsBaseVertex.
+// Принадлежит вызывающему коду и должен жить до отправки очереди.
+struct MultiDrawBatch {
+    GLuint indirectBuffer = 0; // Буфер с командами DrawElementsIndirectCommand (0 - используется запасной путь).
+    size_t indirectOffset = 0; // Смещение первой команды набора в indirectBuffer.
+    std::vector<GLsizei> counts; // Массивы для glMultiDrawElementsBaseVertex.
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+    GLsizei drawCount = 0;
+};
+
+// Копия геометрии модели в памяти CPU для бэкендов, которые не читают буферы OpenGL (SoftwareRasterizer).
+// Индексы хранятся как GLuint независимо от типа индексов в видеопамяти, перезапуск - PRIMITIVE_RESTART_INDEX.
+struct CpuMesh {
+    std::vector<InterleavedVertex> vertices;
+    std::vector<GLuint> indices;
+};
+
+// Команда отрисовки одной модели. Ключ сортировки (от старших битов к младшим):
+// смешивание (1 бит) | программа (15 бит) | VAO (24 бита) | режимы граней (4 бита) | примитив (4 бита).
+// Бит смешивания ставит полупрозрачные команды после непрозрачных; между собой они не переставляются (DrawQueue::flush).
+struct DrawCommand {
+    uint64_t key = 0;
+    GLuint program = 0, vao = 0;
+    GLenum mode = GL_TRIANGLES; // Тип примитива.
+    GLsizei count = 0; // Количество вершин или индексов.
+    GLsizei instances = 1; // Количество экземпляров (больше 1 - инстансинг).
+    GLenum indexType = 0; // Тип индексов (0 - отрисовка без индексов).
+    const MultiDrawBatch* batch = nullptr; // Набор отрисовок одним вызовом (вместо count).
+    const char* label = nullptr; // Подпись для замера времени GPU (имя модели).
+    const PositionTransform* transform = nullptr; // Восстановление сжатых позиций (nullptr - позиции не сжаты).
+    const CpuMesh* mesh = nullptr; // Геометрия на стороне CPU (если ее хранит модель, см. RenderBackend::usesCpuGeometry).
+    DrawState state;
+
+    static uint64_t makeKey(GLuint program, GLuint vao, const DrawState& state, GLenum mode) {
+        uint64_t polygon = ((state.polygonFront - GL_POINT) & 3u) << 2 | ((state.polygonBack - GL_POINT) & 3u);
+        return (uint64_t)state.blend << 63 | (uint64_t)(program & 0x7FFFu) << 48 | (uint64_t)(vao & 0xFFFFFFu) << 24 | polygon << 20 | (uint64_t)(mode & 0xFu) << 16;
+    }
+};
+
+// Счетчики одной отправки очереди: сколько было команд и сколько раз менялись программа и VAO.
+struct DrawQueueStats {
+    long commands = 0;
+    long programSwitches = 0;
+    long vaoSwitches = 0;
+    long drawCalls = 0; // Количество вызовов glDraw* (набор MultiDrawBatch считается одним вызовом).
+};
+
+// Исполнитель команд очереди. DrawQueue::flush передает ему отсортированные команды по одной
+// между beginFrame и finish; по умолчанию команды выполняет OpenGL (GLBackend).
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+    virtual std::string name() const = 0;
+    // true, если бэкенд рисует из CpuMesh: тогда модели сохраняют копию геометрии при загрузке.
+    virtual bool usesCpuGeometry() const { return false; }
+    virtual void beginFrame(int width, int height) = 0; // Область отрисовки и очистка цвета и глубины.
+    virtual void draw(const DrawCommand& command) = 0;
+    virtual void finish() {} // Конец отправки очереди: выполнение накопленной работы.
+};
+
+// Выполнение команд через OpenGL. Изменения состояния идут через glState().
+class GLBackend : public RenderBackend {
+private:
+    // Uniform-переменные программы, которые задает бэкенд, и последние записанные в них значения:
+    // position_scale и position_offset (сжатые позиции), line_width, line_round и viewport_size (толстые линии),
+    // point_size (точечные спрайты).
+    struct ProgramUniforms {
+        GLint scale = -1, offset = -1; PositionTransform value;
+        GLint lineWidth = -1, lineRound = -1, viewport = -1;
+        GLfloat lineWidthValue = -1.0f; GLint lineRoundValue = -1; glm::ivec2 viewportValue = glm::ivec2(0);
+        GLint pointSize = -1; GLfloat pointSizeValue = -1.0f;
+    };
+    std::unordered_map<GLuint, ProgramUniforms> uniforms;
+    glm::ivec2 viewport = glm::ivec2(0); // Размер области отрисовки текущего кадра.
+    GLfloat maxPointSize = 0.0f; // Наибольший размер точки драйвера (GL_POINT_SIZE_RANGE), читается при первой точке.
+
+    ProgramUniforms& programUniforms(GLuint program) {
+        auto it = uniforms.find(program);
+        if (it == uniforms.end()) {
+            ProgramUniforms u;
+            u.scale = glGetUniformLocation(program, "position_scale");
+            u.offset = glGetUniformLocation(program, "position_offset");
+            u.lineWidth = glGetUniformLocation(program, "line_width");
+            u.lineRound = glGetUniformLocation(program, "line_round");
+            u.viewport = glGetUniformLocation(program, "viewport_size");
+            u.pointSize = glGetUniformLocation(program, "point_size");
+            it = uniforms.emplace(program, u).first; // Начальные значения заданы в шейдере: масштаб 1, сдвиг 0.
+        }
+        return it->second;
+    }
+    void applyTransform(ProgramUniforms& u, const PositionTransform* transform) { // Программа должна быть текущей.
+        const PositionTransform value = transform ? *transform : PositionTransform();
+        if (u.scale < 0 || (u.value.scale == value.scale && u.value.offset == value.offset)) return;
+        glUniform3fv(u.scale, 1, &value.scale[0]);
+        glUniform3fv(u.offset, 1, &value.offset[0]);
+        u.value = value;
+    }
+    void applyLineStyle(ProgramUniforms& u, const DrawState& state) { // Только для программ толстых линий.
+        if (u.lineWidth < 0) return;
+        if (viewport.x == 0) { GLint v[4]; glGetIntegerv(GL_VIEWPORT, v); viewport = glm::ivec2(v[2], v[3]); } // Кадр начат без beginFrame.
+        GLint round = state.lineJoin == LineJoin::Round;
+        if (u.lineWidthValue != state.lineWidth) { glUniform1f(u.lineWidth, state.lineWidth); u.lineWidthValue = state.lineWidth; }
+        if (u.lineRound >= 0 && u.lineRoundValue != round) { glUniform1i(u.lineRound, round); u.lineRoundValue = round; }
+        if (u.viewport >= 0 && u.viewportValue != viewport) { glUniform2f(u.viewport, (GLfloat)viewport.x, (GLfloat)viewport.y); u.viewportValue = viewport; }
+    }
+    void applyPointSize(ProgramUniforms& u, GLfloat size) { // Спрайт не больше предела драйвера, иначе сглаживание считается по чужому размеру.
+        if (u.pointSize < 0) return;
+        if (maxPointSize == 0.0f) { GLfloat range[2] = { 1.0f, 1.0f }; glGetFloatv(GL_POINT_SIZE_RANGE, range); maxPointSize = range[1]; }
+        size = std::min(size, maxPointSize);
+        if (u.pointSizeValue != size) { glUniform1f(u.pointSize, size); u.pointSizeValue = size; }
+    }
+public:
+    std::string name() const override { const GLubyte* renderer = glGetString(GL_RENDERER); return renderer ? (const char*)renderer : "OpenGL"; }
+    void beginFrame(int width, int height) override {
+        glState().beginFrame();
+        glState().viewport(0, 0, width, height);
+        viewport = glm::ivec2(width, height);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+    void draw(const DrawCommand& c) override {
+        GLStateCache& gl = glState();
+        gl.useProgram(c.program);
+        ProgramUniforms& u = programUniforms(c.program);
+        applyTransform(u, c.transform);
+        applyLineStyle(u, c.state);
+        gl.bindVertexArray(c.vao);
+        if (c.state.polygonFront == c.state.polygonBack) gl.polygonMode(GL_FRONT_AND_BACK, c.state.polygonFront);
+        else { gl.polygonMode(GL_FRONT, c.state.polygonFront); gl.polygonMode(GL_BACK, c.state.polygonBack); }
+        if (c.mode == GL_POINTS || c.state.polygonFront == GL_POINT || c.state.polygonBack == GL_POINT) { gl.pointSize(c.state.pointSize); applyPointSize(u, c.state.pointSize); }
+        if (c.mode == GL_LINES || c.mode == GL_LINE_LOOP || c.mode == GL_LINE_STRIP) gl.lineWidth(c.state.lineWidth);
+        gl.setEnabled(GL_BLEND, c.state.blend);
+        if (c.indexType) gl.primitiveRestartIndex(restartIndexFor(c.indexType)); // У 8- и 16-битных индексов свой индекс перезапуска.
+        if (c.batch) {
+            if (c.batch->drawCount == 0) return;
+            if (c.batch->indirectBuffer) {
+                glBindBuffer(GL_DRAW_INDIRECT_BUFFER, c.batch->indirectBuffer);
+                glMultiDrawElementsIndirect(c.mode, c.indexType, (const void*)c.batch->indirectOffset, c.batch->drawCount, 0);
+            }
+            else glMultiDrawElementsBaseVertex(c.mode, const_cast<GLsizei*>(c.batch->counts.data()), c.indexType,
+                const_cast<void**>(c.batch->offsets.data()), c.batch->drawCount, const_cast<GLint*>(c.batch->baseVertices.data()));
+        }
+        else if (c.instances != 1) {
+            if (c.indexType) glDrawElementsInstanced(c.mode, c.count, c.indexType, 0, c.instances);
+            else glDrawArraysInstanced(c.mode, 0, c.count, c.instances);
+        }
+        else if (c.indexType) glDrawElements(c.mode, c.count, c.indexType, 0);
+        else glDrawArrays(c.mode, 0, c.count);
+    }
+};
+
+inline GLBackend& glBackend() { static GLBackend backend; return backend; }
+
+// Очередь команд отрисовки. Модели ставят команды в очередь, а flush() сортирует их по ключу
+// и передает бэкенду (по умолчанию OpenGL), так что смены программы и VAO происходят минимальное число раз.
+// Сортировка устойчивая: команды с одинаковым ключом рисуются в порядке постановки.
+// Модели и их VAO должны жить до вызова flush().
+class DrawQueue {
+private:
+    std::vector<DrawCommand> commands;
+public:
+    DrawState state; // Состояние, которое получат следующие команды.
+    DrawQueueStats lastFlush; // Счетчики последней отправки.
+    unsigned long flushes = 0; // Число отправок: по нему владельцы наборов MultiDrawBatch узнают, что наборы уже нарисованы.
+    GpuTimer* timer = nullptr; // Если задан, время GPU каждой команды замеряется метками GL_TIMESTAMP (только для OpenGL).
+    RenderBackend* backend = &glBackend(); // Исполнитель команд. Меняется до загрузки моделей (см. RenderBackend::usesCpuGeometry).
+
+    void push(GLuint program, GLuint vao, GLenum mode, GLsizei count, GLenum indexType, GLsizei instances = 1, const char* label = nullptr,
+        const PositionTransform* transform = nullptr, const CpuMesh* mesh = nullptr) {
+        DrawCommand command;
+        command.key = DrawCommand::makeKey(program, vao, state, mode);
+        command.program = program; command.vao = vao; command.mode = mode;
+        command.count = count; command.indexType = indexType; command.instances = instances; command.state = state; command.label = label;
+        command.transform = transform; command.mesh = mesh;
+        commands.push_back(command);
+    }
+    void pushBatch(GLuint program, GLuint vao, GLenum mode, const MultiDrawBatch& batch, const char* label = nullptr, GLenum indexType = GL_UNSIGNED_INT,
+        const PositionTransform* transform = nullptr, const CpuMesh* mesh = nullptr) {
+        push(program, vao, mode, 0, indexType, 1, label, transform, mesh);
+        commands.back().batch = &batch;
+    }
+    size_t size() const { return commands.size(); }
+
+    void flush(bool sorted = true) { // Отправка всех команд бэкенду (sorted = false сохраняет порядок постановки).
+        // Команды со смешиванием идут после непрозрачных в порядке постановки: результат смешивания зависит от порядка.
+        const uint64_t blendBit = 1ull << 63;
+        if (sorted) std::stable_sort(commands.begin(), commands.end(), [&](const DrawCommand& a, const DrawCommand& b) {
+            return (a.key & b.key & blendBit) ? false : a.key < b.key; });
+        DrawQueueStats stats;
+        GLuint lastProgram = 0, lastVao = 0;
+        if (timer && !commands.empty()) timer->stamp(nullptr);
+        for (const DrawCommand& c : commands) {
+            if (stats.commands == 0 || c.program != lastProgram) { stats.programSwitches++; lastProgram = c.program; }
+            if (stats.commands == 0 || c.vao != lastVao) { stats.vaoSwitches++; lastVao = c.vao; }
+            stats.commands++;
+            stats.drawCalls++;
+            backend->draw(c);
+            if (timer) timer->stamp(c.label);
+        }
+        backend->finish();
+        lastFlush = stats;
+        flushes++;
+        commands.clear();
+    }
+};
+
+// Общая очередь отрисовки приложения.
+inline DrawQueue& drawQueue() { static DrawQueue queue; return queue; }
@@ -0,0 +1,228 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "hash.h"
+
+// Что делать с прочитанными кадрами: записать в файл (RGBA без заголовка, PPM, видео Y4M) или только посчитать хэш.
+enum class CaptureFormat { Raw = 1, PPM, Y4M, Hash };
+
+// Кадр, прочитанный из буфера кадра: пиксели RGBA8 построчно снизу вверх, как их возвращает glReadPixels.
+struct CapturedFrame {
+    int width = 0, height = 0;
+    int tag = 0; // Метка, переданная в capture (номер задания).
+    long index = 0; // Номер кадра с начала захвата.
+    std::vector<uint8_t> pixels;
+};
+
+// Формат по расширению имени файла: .ppm, .y4m, иначе RGBA без заголовка.
+inline CaptureFormat captureFormatFor(const std::string& path) {
+    auto endsWith = [&](const char* suffix) { size_t n = strlen(suffix); return path.size() >= n && path.compare(path.size() - n, n, suffix) == 0; };
+    if (endsWith(".ppm")) return CaptureFormat::PPM;
+    if (endsWith(".y4m")) return CaptureFormat::Y4M;
+    return CaptureFormat::Raw;
+}
+
+// Запись кадра в формате PPM (P6, RGB сверху вниз). Несколько кадров в одном файле идут подряд, как допускает формат.
+inline void writePPM(std::ostream& out, const CapturedFrame& frame) {
+    out << "P6\n" << frame.width << " " << frame.height << "\n255\n";
+    std::vector<uint8_t> row((size_t)frame.width * 3);
+    for (int y = frame.height - 1; y >= 0; --y) {
+        const uint8_t* src = frame.pixels.data() + (size_t)y * frame.width * 4;
+        for (int x = 0; x < frame.width; ++x) memcpy(&row[(size_t)x * 3], src + (size_t)x * 4, 3);
+        out.write((const char*)row.data(), row.size());
+    }
+}
+
+// Запись кадра видеопотока Y4M (YUV 4:2:0, полный диапазон BT.601, цветность усредняется по блокам 2x2).
+// Заголовок потока пишется перед первым кадром с его размером.
+inline void writeY4MFrame(std::ostream& out, const CapturedFrame& frame, bool header, int fps) {
+    int w = frame.width, h = frame.height, cw = (w + 1) / 2, ch = (h + 1) / 2;
+    if (header) out << "YUV4MPEG2 W" << w << " H" << h << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+    std::vector<uint8_t> planes((size_t)w * h + 2 * (size_t)cw * ch);
+    uint8_t* yPlane = planes.data(), * uPlane = yPlane + (size_t)w * h, * vPlane = uPlane + (size_t)cw * ch;
+    auto pixel = [&](int x, int y) { return frame.pixels.data() + ((size_t)(h - 1 - y) * w + x) * 4; }; // Строка y сверху.
+    auto clampByte = [](float v) { return (uint8_t)std::min(255.0f, std::max(0.0f, v + 0.5f)); };
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) { const uint8_t* p = pixel(x, y); yPlane[(size_t)y * w + x] = clampByte(0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]); }
+    for (int y = 0; y < ch; ++y) {
+        for (int x = 0; x < cw; ++x) {
+            float r = 0.0f, g = 0.0f, b = 0.0f; int n = 0;
+            for (int dy = 0; dy < 2 && 2 * y + dy < h; ++dy)
+                for (int dx = 0; dx < 2 && 2 * x + dx < w; ++dx) { const uint8_t* p = pixel(2 * x + dx, 2 * y + dy); r += p[0]; g += p[1]; b += p[2]; n++; }
+            r /= n; g /= n; b /= n;
+            uPlane[(size_t)y * cw + x] = clampByte(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+            vPlane[(size_t)y * cw + x] = clampByte(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+        }
+    }
+    out << "FRAME\n";
+    out.write((const char*)planes.data(), planes.size());
+}
+
+// Асинхронное чтение кадров через кольцо из RingSize пиксельных буферов (PBO). capture() только ставит
+// glReadPixels в буфер текущего кадра и ставит метку синхронизации, а данные кадра, запрошенного двумя кадрами
+// раньше, к этому времени уже готовы и копируются из отображенного буфера без остановки конвейера.
+// Запись в файл или подсчет хэша выполняет фоновый поток; если он не успевает, capture ждет освобождения очереди.
+// Все методы, кроме hashes(), вызываются из потока с контекстом OpenGL.
+class FrameCapture {
+public:
+    static const int RingSize = 3; // Кадр забирается через RingSize - 1 кадров после запроса.
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        size_t size = 0;
+        GLsync fence = nullptr;
+        int width = 0, height = 0, tag = 0;
+        long index = 0;
+        bool pending = false;
+    };
+    Slot ring[RingSize];
+    int next = 0; // Слот для следующего кадра (он же самый старый).
+    long frameIndex = 0;
+    CaptureFormat format = CaptureFormat::Hash;
+    std::ofstream file;
+    bool running = false, y4mHeader = true;
+    int y4mWidth = 0, y4mHeight = 0; // Размер кадров видеопотока (задается первым кадром).
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable ready, space;
+    std::deque<CapturedFrame> queue; // Кадры для фонового потока.
+    std::vector<std::vector<uint8_t>> pool; // Освободившиеся буферы пикселей для повторного использования.
+    std::map<int, uint64_t> lastHashes; // Хэш последнего кадра по меткам.
+    bool stopping = false;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            ready.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            CapturedFrame frame = std::move(queue.front());
+            queue.pop_front();
+            space.notify_one();
+            lock.unlock();
+            uint64_t hash = hashBytes(frame.pixels.data(), frame.pixels.size());
+            if (format == CaptureFormat::PPM) writePPM(file, frame);
+            else if (format == CaptureFormat::Y4M) {
+                if (y4mHeader) { y4mWidth = frame.width; y4mHeight = frame.height; }
+                if (frame.width == y4mWidth && frame.height == y4mHeight) writeY4MFrame(file, frame, y4mHeader, fps); // Кадры другого размера (после изменения окна) пропускаются.
+                y4mHeader = false;
+            }
+            else if (format == CaptureFormat::Raw) file.write((const char*)frame.pixels.data(), frame.pixels.size());
+            lock.lock();
+            lastHashes[frame.tag] = hash;
+            written++;
+            pool.push_back(std::move(frame.pixels));
+        }
+    }
+    void enqueue(CapturedFrame&& frame) {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [&] { return queue.size() < maxQueued; });
+        queue.push_back(std::move(frame));
+        ready.notify_one();
+    }
+    std::vector<uint8_t> buffer(size_t size) { // Буфер пикселей из пула или новый.
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<uint8_t> pixels;
+        if (!pool.empty()) { pixels = std::move(pool.back()); pool.pop_back(); }
+        pixels.resize(size);
+        return pixels;
+    }
+    void collect(Slot& slot) { // Копирование готового кадра из PBO (ожидание, только если GPU отстал больше чем на кольцо).
+        if (!slot.pending) return;
+        auto start = std::chrono::steady_clock::now();
+        while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+        waitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        CapturedFrame frame;
+        frame.width = slot.width; frame.height = slot.height; frame.tag = slot.tag; frame.index = slot.index;
+        frame.pixels = buffer(slot.size);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if (const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT)) {
+            memcpy(frame.pixels.data(), data, slot.size);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.pending = false;
+        enqueue(std::move(frame));
+    }
+public:
+    size_t maxQueued = 8; // Наибольшее число кадров, ждущих фоновый поток.
+    int fps = 60; // Частота кадров в заголовке Y4M.
+    long written = 0; // Обработано кадров фоновым потоком (под mutex).
+    double waitSeconds = 0.0; // Время ожидания готовности PBO в capture (признак остановки конвейера).
+
+    FrameCapture() = default;
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+    ~FrameCapture() {
+        stop();
+        for (Slot& slot : ring) { if (slot.fence) glDeleteSync(slot.fence); if (slot.pbo) glDeleteBuffers(1, &slot.pbo); }
+    }
+
+    // Запуск захвата: path - файл для записи (формат по расширению) или пустая строка, если нужны только хэши.
+    // Возвращает false, если файл не удалось открыть.
+    bool start(const std::string& path) {
+        stop();
+        format = path.empty() ? CaptureFormat::Hash : captureFormatFor(path);
+        if (!path.empty()) { file.open(path, std::ios::binary | std::ios::trunc); if (!file) return false; }
+        frameIndex = 0; written = 0; waitSeconds = 0.0; y4mHeader = true;
+        lastHashes.clear();
+        stopping = false;
+        running = true;
+        thread = std::thread(&FrameCapture::run, this);
+        return true;
+    }
+    // Запрос чтения текущего буфера кадра (GL_READ_FRAMEBUFFER, до glfwSwapBuffers) размером width x height.
+    void capture(int width, int height, int tag = 0) {
+        if (!running) return;
+        Slot& slot = ring[next]; // Свободен: его кадр забран в конце предыдущего вызова.
+        size_t size = (size_t)width * height * 4;
+        if (!slot.pbo) glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if (slot.size != size) { glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ); slot.size = size; }
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.width = width; slot.height = height; slot.tag = tag; slot.index = frameIndex++;
+        slot.pending = true;
+        next = (next + 1) % RingSize;
+        collect(ring[next]); // Самый старый запрос - кадр, запрошенный RingSize - 1 кадров назад.
+    }
+    // Передача уже готового кадра из памяти (RGBA8 снизу вверх), например результата программного растеризатора.
+    void submit(const void* rgba, int width, int height, int tag = 0) {
+        if (!running) return;
+        CapturedFrame frame;
+        frame.width = width; frame.height = height; frame.tag = tag; frame.index = frameIndex++;
+        frame.pixels = buffer((size_t)width * height * 4);
+        memcpy(frame.pixels.data(), rgba, frame.pixels.size());
+        enqueue(std::move(frame));
+    }
+    // Забирает оставшиеся кадры из кольца и ждет, пока фоновый поток их обработает.
+    void stop() {
+        if (!running) return;
+        for (int i = 0; i < RingSize; ++i) collect(ring[(next + i) % RingSize]); // От самого старого к новому.
+        { std::lock_guard<std::mutex> lock(mutex); stopping = true; }
+        ready.notify_one();
+        thread.join();
+        if (file.is_open()) file.close();
+        running = false;
+    }
+    bool isRunning() const { return running; }
+    // Хэши последних кадров по меткам (после stop или из любого потока под блокировкой).
+    std::map<int, uint64_t> hashes() { std::lock_guard<std::mutex> lock(mutex); return lastHashes; }
+};
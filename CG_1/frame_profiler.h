@@ -0,0 +1,196 @@
+#pragma once
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // std::min и std::max не должны подменяться макросами windows.h.
+#endif
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Процессорное время процесса (все потоки, пользовательский режим и ядро) в секундах.
+inline double processCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exited, &kernel, &user)) return 0.0;
+    auto seconds = [](const FILETIME& t) { return (((unsigned long long)t.dwHighDateTime << 32) | t.dwLowDateTime) * 1e-7; }; // Интервалы по 100 нс.
+    return seconds(kernel) + seconds(user);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+// Замер одного кадра.
+struct FrameSample {
+    double cpuMs = 0.0; // Время формирования кадра на CPU (от beginFrame до endFrame).
+    double gpuMs = -1.0; // Время выполнения кадра на GPU (GL_TIME_ELAPSED, -1 - результат еще не получен).
+    double frameMs = 0.0; // Полное время от конца предыдущего кадра до конца этого.
+    long drawCalls = 0;
+};
+
+// Процентили одной величины по кадрам задания.
+struct FramePercentiles {
+    double p50 = 0.0, p95 = 0.0, p99 = 0.0;
+};
+
+// Профилировщик кадров: время CPU, время GPU через запросы GL_TIME_ELAPSED и число вызовов отрисовки
+// отдельно для каждого задания. Результат запроса читается через несколько кадров, когда он уже готов,
+// поэтому замер не останавливает конвейер. Для каждого задания хранятся последние historyLimit кадров.
+class FrameProfiler {
+public:
+    static const int Tasks = 8;
+    static const int QueryCount = 4; // Запросов в кольце: результат ждет не больше QueryCount - 1 кадров.
+private:
+    struct PendingQuery { int task = 0; size_t sample = 0; bool active = false; };
+    GLuint queries[QueryCount] = {};
+    PendingQuery pending[QueryCount];
+    int nextQuery = 0;
+    bool gpuTimer = false, initialized = false;
+    std::vector<FrameSample> samples[Tasks];
+    size_t recorded[Tasks] = {}; // Сколько кадров записано всего (после historyLimit старые перезаписываются по кругу).
+    int currentTask = 0;
+    int lastTask = 0; size_t lastSample = 0; // Последний записанный кадр (ему presented() добавит полное время).
+    double frameStart = 0.0, lastFrameEnd = 0.0;
+
+    void collect(int index, bool wait) { // Чтение результата запроса, если он готов (или ожидание при wait).
+        PendingQuery& query = pending[index];
+        if (!query.active) return;
+        GLint available = GL_FALSE;
+        if (!wait) glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!wait && !available) return;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &nanoseconds);
+        std::vector<FrameSample>& list = samples[query.task - 1];
+        if (query.sample < list.size()) list[query.sample].gpuMs = nanoseconds / 1e6;
+        query.active = false;
+    }
+    static FramePercentiles percentiles(std::vector<double> values) { // Процентили методом ближайшего ранга.
+        FramePercentiles result;
+        if (values.empty()) return result;
+        std::sort(values.begin(), values.end());
+        auto rank = [&](double p) { size_t i = (size_t)(p * values.size()); return values[std::min(i, values.size() - 1)]; };
+        result.p50 = rank(0.50); result.p95 = rank(0.95); result.p99 = rank(0.99);
+        return result;
+    }
+    template <typename Field> std::vector<double> values(int task, Field field) const {
+        std::vector<double> result;
+        for (const FrameSample& sample : samples[task - 1]) if (sample.*field >= 0.0) result.push_back(sample.*field);
+        return result;
+    }
+public:
+    size_t historyLimit = 1000;
+
+    FrameProfiler() = default;
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+    ~FrameProfiler() { if (initialized && gpuTimer) glDeleteQueries(QueryCount, queries); }
+
+    bool hasGpuTimer() const { return gpuTimer; }
+
+    void beginFrame(int task) {
+        if (!initialized) { // Запросы создаются при первом кадре, когда контекст OpenGL уже есть.
+            initialized = true;
+            gpuTimer = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+            if (gpuTimer) glGenQueries(QueryCount, queries);
+            lastFrameEnd = glfwGetTime();
+        }
+        currentTask = (task >= 1 && task <= Tasks) ? task : 0;
+        frameStart = glfwGetTime();
+        if (gpuTimer && currentTask) {
+            collect(nextQuery, false);
+            if (pending[nextQuery].active) collect(nextQuery, true); // Кольцо заполнено: GPU отстает больше чем на QueryCount кадров.
+            glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery]);
+        }
+    }
+    void endFrame(long drawCalls) {
+        if (!currentTask) return;
+        double now = glfwGetTime();
+        FrameSample sample;
+        sample.cpuMs = (now - frameStart) * 1000.0;
+        sample.drawCalls = drawCalls;
+        std::vector<FrameSample>& list = samples[currentTask - 1];
+        size_t index = recorded[currentTask - 1]++ % historyLimit;
+        if (index < list.size()) list[index] = sample; else list.push_back(sample);
+        lastTask = currentTask; lastSample = index;
+        if (gpuTimer) {
+            glEndQuery(GL_TIME_ELAPSED);
+            pending[nextQuery] = { currentTask, index, true };
+            nextQuery = (nextQuery + 1) % QueryCount;
+            for (int i = 0; i < QueryCount; ++i) collect(i, false);
+        }
+        currentTask = 0;
+    }
+    void presented() { // Кадр выведен (после glfwSwapBuffers или glFinish): фиксируем полное время кадра.
+        double now = glfwGetTime();
+        if (lastTask) samples[lastTask - 1][lastSample].frameMs = (now - lastFrameEnd) * 1000.0;
+        lastTask = 0;
+        lastFrameEnd = now;
+    }
+    void resume() { lastFrameEnd = glfwGetTime(); } // После ожидания событий: простой не входит в полное время следующего кадра.
+    void finish() { for (int i = 0; i < QueryCount; ++i) collect(i, true); } // Дождаться всех результатов GPU.
+    void reset() { finish(); lastTask = 0; for (int task = 0; task < Tasks; ++task) { samples[task].clear(); recorded[task] = 0; } }
+
+    size_t sampleCount(int task) const { return samples[task - 1].size(); }
+    FramePercentiles cpu(int task) const { return percentiles(values(task, &FrameSample::cpuMs)); }
+    FramePercentiles gpu(int task) const { return percentiles(values(task, &FrameSample::gpuMs)); }
+    FramePercentiles frame(int task) const { return percentiles(values(task, &FrameSample::frameMs)); }
+    long drawCalls(int task) const { return samples[task - 1].empty() ? 0 : samples[task - 1].back().drawCalls; }
+
+    void printSummary(std::ostream& out) const { // Таблица процентилей по заданиям, для которых есть замеры.
+        out << "Task  frames   CPU p50/p95/p99 ms          GPU p50/p95/p99 ms          frame p50/p95/p99 ms        draws\n";
+        out << std::fixed << std::setprecision(3);
+        for (int task = 1; task <= Tasks; ++task) {
+            if (samples[task - 1].empty()) continue;
+            out << std::setw(4) << task << std::setw(8) << sampleCount(task);
+            for (const FramePercentiles& p : { cpu(task), gpu(task), frame(task) })
+                out << "   " << std::setw(7) << p.p50 << " " << std::setw(7) << p.p95 << " " << std::setw(7) << p.p99 << "  ";
+            out << std::setw(5) << drawCalls(task) << "\n";
+        }
+        if (!gpuTimer) out << "  (GPU timer queries are not supported, GPU time is reported as 0)\n";
+    }
+    // Запись процентилей в файл: JSON, если имя оканчивается на .json, иначе CSV. Возвращает false при ошибке записи.
+    bool write(const std::string& path, const std::string& renderer) const {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) return false;
+        file << std::fixed << std::setprecision(4);
+        bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        if (json) {
+            std::string escaped;
+            for (char c : renderer) { if (c == '"' || c == '\\') escaped += '\\'; escaped += c; }
+            file << "{\n  \"renderer\": \"" << escaped << "\",\n  \"gpu_timer\": " << (gpuTimer ? "true" : "false") << ",\n  \"tasks\": [";
+            bool first = true;
+            for (int task = 1; task <= Tasks; ++task) {
+                if (samples[task - 1].empty()) continue;
+                file << (first ? "\n" : ",\n") << "    { \"task\": " << task << ", \"frames\": " << sampleCount(task) << ", \"draw_calls\": " << drawCalls(task);
+                const struct { const char* name; FramePercentiles p; } metrics[] = { { "cpu_ms", cpu(task) }, { "gpu_ms", gpu(task) }, { "frame_ms", frame(task) } };
+                for (const auto& m : metrics)
+                    file << ", \"" << m.name << "\": { \"p50\": " << m.p.p50 << ", \"p95\": " << m.p.p95 << ", \"p99\": " << m.p.p99 << " }";
+                file << " }";
+                first = false;
+            }
+            file << "\n  ]\n}\n";
+        }
+        else {
+            file << "task,frames,draw_calls,cpu_p50_ms,cpu_p95_ms,cpu_p99_ms,gpu_p50_ms,gpu_p95_ms,gpu_p99_ms,frame_p50_ms,frame_p95_ms,frame_p99_ms\n";
+            for (int task = 1; task <= Tasks; ++task) {
+                if (samples[task - 1].empty()) continue;
+                file << task << "," << sampleCount(task) << "," << drawCalls(task);
+                for (const FramePercentiles& p : { cpu(task), gpu(task), frame(task) }) file << "," << p.p50 << "," << p.p95 << "," << p.p99;
+                file << "\n";
+            }
+        }
+        return (bool)file;
+    }
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+
+#include <GL/glew.h>
+
+#include "gl_state.h"
+
+// Счетчики живых объектов OpenGL, созданных через обертки ниже (для поиска утечек).
+struct GLObjectCounters {
+    long buffers = 0;
+    long vertexArrays = 0;
+    long total() const { return buffers + vertexArrays; }
+};
+inline GLObjectCounters& glObjectCounters() { static GLObjectCounters counters; return counters; }
+
+// Владеющая обертка над буферным объектом OpenGL (VBO/EBO). Копирование запрещено, перемещение передает владение.
+class GLBuffer {
+private:
+    GLuint id = 0; // ID буфера (0 - буфер еще не создан).
+    size_t capacity = 0; // Размер выделенной под буфер видеопамяти в байтах.
+public:
+    GLBuffer() = default;
+    GLBuffer(const GLBuffer&) = delete;
+    GLBuffer& operator=(const GLBuffer&) = delete;
+    GLBuffer(GLBuffer&& other) noexcept : id(other.id), capacity(other.capacity) { other.id = 0; other.capacity = 0; }
+    GLBuffer& operator=(GLBuffer&& other) noexcept {
+        if (this != &other) { release(); std::swap(id, other.id); std::swap(capacity, other.capacity); }
+        return *this;
+    }
+    ~GLBuffer() { release(); }
+
+    // Загрузка данных с привязкой буфера к target. Если данные помещаются в уже выделенную память,
+    // она обновляется на месте через glBufferSubData без повторного выделения.
+    void upload(GLenum target, const void* data, size_t size, GLenum usage = GL_STATIC_DRAW) {
+        if (id == 0) { glGenBuffers(1, &id); glObjectCounters().buffers++; }
+        glBindBuffer(target, id);
+        if (size > 0 && size <= capacity) glBufferSubData(target, 0, size, data);
+        else { glBufferData(target, size, data, usage); capacity = size; }
+    }
+    // Выделение неизменяемой памяти через glBufferStorage (например, для постоянного отображения в память).
+    // Размер такого буфера менять нельзя, upload допустим только в пределах выделенного.
+    void allocateStorage(GLenum target, size_t size, GLbitfield flags) {
+        release();
+        glGenBuffers(1, &id); glObjectCounters().buffers++;
+        glBindBuffer(target, id);
+        glBufferStorage(target, size, nullptr, flags);
+        capacity = size;
+    }
+    void bind(GLenum target) const { glBindBuffer(target, id); }
+    void release() { // Удаление буфера из видеопамяти.
+        if (id == 0) return;
+        glDeleteBuffers(1, &id); glObjectCounters().buffers--;
+        id = 0; capacity = 0;
+    }
+    GLuint get() const { return id; }
+    size_t size() const { return capacity; }
+};
+
+// Владеющая обертка над объектом вершинного массива (VAO).
+class GLVertexArray {
+private:
+    GLuint id = 0;
+public:
+    GLVertexArray() { glGenVertexArrays(1, &id); glObjectCounters().vertexArrays++; }
+    GLVertexArray(const GLVertexArray&) = delete;
+    GLVertexArray& operator=(const GLVertexArray&) = delete;
+    GLVertexArray(GLVertexArray&& other) noexcept : id(other.id) { other.id = 0; }
+    GLVertexArray& operator=(GLVertexArray&& other) noexcept {
+        if (this != &other) { release(); std::swap(id, other.id); }
+        return *this;
+    }
+    ~GLVertexArray() { release(); }
+
+    void bind() const { glState().bindVertexArray(id); }
+    void release() {
+        if (id == 0) return;
+        glDeleteVertexArrays(1, &id); glObjectCounters().vertexArrays--;
+        glState().forgetVertexArray(id);
+        id = 0;
+    }
+    GLuint get() const { return id; }
+};
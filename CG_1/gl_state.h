@@ -0,0 +1,137 @@
+#pragma once
+#include <vector>
+#include <utility>
+
+#include <GL/glew.h>
+
+// Количество вызовов OpenGL, прошедших через кэш состояния: выполненных и пропущенных как избыточные.
+struct GLStateStats {
+    long issued = 0;
+    long elided = 0;
+};
+
+// Функции OpenGL 1.1, которые вызывает кэш состояния. Они экспортируются библиотекой OpenGL напрямую, а не через
+// указатели GLEW, поэтому кэш вызывает их через эту таблицу, чтобы GLCallCounter мог подменить их счетчиками.
+struct GLLegacyFunctions {
+    void (GLAPIENTRY* viewport)(GLint, GLint, GLsizei, GLsizei) = glViewport;
+    void (GLAPIENTRY* polygonMode)(GLenum, GLenum) = glPolygonMode;
+    void (GLAPIENTRY* pointSize)(GLfloat) = glPointSize;
+    void (GLAPIENTRY* lineWidth)(GLfloat) = glLineWidth;
+    void (GLAPIENTRY* enable)(GLenum) = glEnable;
+    void (GLAPIENTRY* disable)(GLenum) = glDisable;
+};
+
+// Теневая копия части состояния OpenGL. Вызовы, которые не меняют состояние, не передаются драйверу.
+// Весь код, меняющий отслеживаемое состояние, должен идти через этот кэш или вызвать invalidate().
+class GLStateCache {
+private:
+    enum Field : unsigned { Program = 1, VertexArray = 2, Viewport = 4, PolygonFront = 8, PolygonBack = 16, PointSize = 32, LineWidth = 64, RestartIndex = 128 };
+    unsigned known = 0; // Поля, значение которых в драйвере точно известно.
+    GLuint program = 0, vertexArray = 0;
+    GLint viewportRect[4] = { 0, 0, 0, 0 };
+    GLenum polygonModes[2] = { GL_FILL, GL_FILL }; // Режимы для лицевых и обратных граней.
+    GLfloat pointSizeValue = 1.0f, lineWidthValue = 1.0f;
+    GLuint restartIndex = 0; // Индекс перезапуска примитива (зависит от типа индексов рисуемой модели).
+    std::vector<std::pair<GLenum, bool>> capabilities; // Известные состояния glEnable/glDisable.
+
+    bool needed(unsigned field, bool same) { // Возвращает true, если вызов нужно выполнить, и обновляет счетчики.
+        if ((known & field) && same) { current.elided++; return false; }
+        known |= field; current.issued++;
+        return true;
+    }
+public:
+    GLStateStats current; // Счетчики текущего кадра.
+    GLStateStats lastFrame; // Счетчики последнего завершенного кадра.
+    GLLegacyFunctions gl; // Вызовы OpenGL 1.1 (подменяются только при проверке счетчиков).
+
+    void beginFrame() { lastFrame = current; current = GLStateStats(); }
+    void invalidate() { known = 0; capabilities.clear(); } // Состояние изменено в обход кэша: все следующие вызовы выполняются.
+
+    void useProgram(GLuint id) { if (needed(Program, program == id)) { program = id; glUseProgram(id); } }
+    void bindVertexArray(GLuint id) { if (needed(VertexArray, vertexArray == id)) { vertexArray = id; glBindVertexArray(id); } }
+    void forgetVertexArray(GLuint id) { if (vertexArray == id) known &= ~VertexArray; } // VAO удален, привязка сброшена драйвером.
+    void viewport(GLint x, GLint y, GLsizei w, GLsizei h) {
+        bool same = viewportRect[0] == x && viewportRect[1] == y && viewportRect[2] == w && viewportRect[3] == h;
+        if (needed(Viewport, same)) { viewportRect[0] = x; viewportRect[1] = y; viewportRect[2] = w; viewportRect[3] = h; gl.viewport(x, y, w, h); }
+    }
+    void polygonMode(GLenum face, GLenum mode) {
+        bool front = face != GL_BACK, back = face != GL_FRONT;
+        bool same = (!front || ((known & PolygonFront) && polygonModes[0] == mode)) && (!back || ((known & PolygonBack) && polygonModes[1] == mode));
+        if (same) { current.elided++; return; }
+        current.issued++;
+        if (front) { polygonModes[0] = mode; known |= PolygonFront; }
+        if (back) { polygonModes[1] = mode; known |= PolygonBack; }
+        gl.polygonMode(face, mode);
+    }
+    void pointSize(GLfloat size) { if (needed(PointSize, pointSizeValue == size)) { pointSizeValue = size; gl.pointSize(size); } }
+    void lineWidth(GLfloat width) { if (needed(LineWidth, lineWidthValue == width)) { lineWidthValue = width; gl.lineWidth(width); } }
+    void primitiveRestartIndex(GLuint index) { if (needed(RestartIndex, restartIndex == index)) { restartIndex = index; glPrimitiveRestartIndex(index); } }
+    void setEnabled(GLenum capability, bool enabled) {
+        for (auto& entry : capabilities) {
+            if (entry.first != capability) continue;
+            if (entry.second == enabled) { current.elided++; return; }
+            entry.second = enabled;
+            current.issued++;
+            enabled ? gl.enable(capability) : gl.disable(capability);
+            return;
+        }
+        capabilities.emplace_back(capability, enabled);
+        current.issued++;
+        enabled ? gl.enable(capability) : gl.disable(capability);
+    }
+    void enable(GLenum capability) { setEnabled(capability, true); }
+    void disable(GLenum capability) { setEnabled(capability, false); }
+};
+
+// Общий кэш состояния для текущего контекста OpenGL (в приложении он один).
+inline GLStateCache& glState() { static GLStateCache cache; return cache; }
+
+// Счетчик настоящих вызовов OpenGL, которыми управляет кэш состояния (для --check-gl-state).
+// install() подменяет указатели GLEW (glUseProgram, glBindVertexArray, glPrimitiveRestartIndex) и таблицу glState().gl
+// обертками, которые считают вызов и передают его драйверу. Указатели GLEW общие для всей программы, поэтому
+// учитываются и вызовы в обход кэша; прямые вызовы функций OpenGL 1.1 в обход кэша не видны.
+class GLCallCounter {
+private:
+    PFNGLUSEPROGRAMPROC useProgram = nullptr;
+    PFNGLBINDVERTEXARRAYPROC bindVertexArray = nullptr;
+    PFNGLPRIMITIVERESTARTINDEXPROC primitiveRestartIndex = nullptr;
+    GLLegacyFunctions legacy;
+    static GLCallCounter*& active() { static GLCallCounter* counter = nullptr; return counter; }
+
+    static void GLAPIENTRY countUseProgram(GLuint id) { active()->calls++; active()->useProgram(id); }
+    static void GLAPIENTRY countBindVertexArray(GLuint id) { active()->calls++; active()->bindVertexArray(id); }
+    static void GLAPIENTRY countPrimitiveRestartIndex(GLuint index) { active()->calls++; active()->primitiveRestartIndex(index); }
+    static void GLAPIENTRY countViewport(GLint x, GLint y, GLsizei w, GLsizei h) { active()->calls++; active()->legacy.viewport(x, y, w, h); }
+    static void GLAPIENTRY countPolygonMode(GLenum face, GLenum mode) { active()->calls++; active()->legacy.polygonMode(face, mode); }
+    static void GLAPIENTRY countPointSize(GLfloat size) { active()->calls++; active()->legacy.pointSize(size); }
+    static void GLAPIENTRY countLineWidth(GLfloat width) { active()->calls++; active()->legacy.lineWidth(width); }
+    static void GLAPIENTRY countEnable(GLenum capability) { active()->calls++; active()->legacy.enable(capability); }
+    static void GLAPIENTRY countDisable(GLenum capability) { active()->calls++; active()->legacy.disable(capability); }
+public:
+    long calls = 0; // Вызовов с последнего сброса.
+
+    GLCallCounter() = default;
+    GLCallCounter(const GLCallCounter&) = delete;
+    GLCallCounter& operator=(const GLCallCounter&) = delete;
+    ~GLCallCounter() { uninstall(); }
+
+    void install() {
+        if (active()) return;
+        active() = this;
+        useProgram = __glewUseProgram; __glewUseProgram = countUseProgram;
+        bindVertexArray = __glewBindVertexArray; __glewBindVertexArray = countBindVertexArray;
+        primitiveRestartIndex = __glewPrimitiveRestartIndex; __glewPrimitiveRestartIndex = countPrimitiveRestartIndex;
+        GLLegacyFunctions& gl = glState().gl;
+        legacy = gl;
+        gl.viewport = countViewport; gl.polygonMode = countPolygonMode; gl.pointSize = countPointSize;
+        gl.lineWidth = countLineWidth; gl.enable = countEnable; gl.disable = countDisable;
+    }
+    void uninstall() {
+        if (active() != this) return;
+        __glewUseProgram = useProgram;
+        __glewBindVertexArray = bindVertexArray;
+        __glewPrimitiveRestartIndex = primitiveRestartIndex;
+        glState().gl = legacy;
+        active() = nullptr;
+    }
+};
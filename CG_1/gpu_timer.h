@@ -0,0 +1,98 @@
+#pragma once
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Суммарное время GPU одной подписи (модели) по всем прочитанным кадрам.
+struct GpuTimerTotals {
+    double ms = 0.0;
+    long samples = 0;
+};
+
+// Кольцо запросов GL_TIMESTAMP для замера времени GPU по отдельным командам отрисовки.
+// Метки ставятся через glQueryCounter до первой команды кадра и после каждой команды, а читаются
+// только через Frames - 1 кадров и только если GL_QUERY_RESULT_AVAILABLE уже true,
+// поэтому замер никогда не ждет GPU. Если результаты кадра к моменту повторного использования
+// его запросов еще не готовы, кадр пропускается (droppedFrames), а не ожидается.
+class GpuTimer {
+public:
+    static const int Frames = 3;
+private:
+    struct FrameQueries {
+        std::vector<GLuint> queries; // Запросы кадра (растут по мере надобности и переиспользуются).
+        std::vector<const char*> labels; // labels[i] - подпись команды между метками i и i + 1.
+        size_t used = 0; // Поставлено меток в этом кадре.
+        long frame = -1; // Номер кадра, чьи метки лежат в запросах (-1 - свободно).
+    };
+    FrameQueries ring[Frames];
+    long frameIndex = -1;
+    bool supported = false, checked = false;
+
+    void resolve(FrameQueries& f) { // Чтение готовых результатов кадра без ожидания.
+        if (f.frame < 0) return;
+        if (f.used > 1) {
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(f.queries[f.used - 1], GL_QUERY_RESULT_AVAILABLE, &available); // Метки выполняются по порядку.
+            if (!available) { droppedFrames++; f.frame = -1; f.used = 0; return; }
+            GLuint64 previous = 0;
+            glGetQueryObjectui64v(f.queries[0], GL_QUERY_RESULT, &previous);
+            for (size_t i = 1; i < f.used; ++i) {
+                GLuint64 stamp = 0;
+                glGetQueryObjectui64v(f.queries[i], GL_QUERY_RESULT, &stamp);
+                GpuTimerTotals& totals = results[f.labels[i - 1] ? f.labels[i - 1] : "(unnamed)"];
+                totals.ms += (stamp - previous) / 1e6;
+                totals.samples++;
+                previous = stamp;
+            }
+            long lag = frameIndex - f.frame;
+            if (resolvedFrames == 0 || lag < minLatency) minLatency = lag;
+            if (lag > maxLatency) maxLatency = lag;
+            resolvedFrames++;
+        }
+        f.frame = -1; f.used = 0;
+    }
+public:
+    std::unordered_map<std::string, GpuTimerTotals> results; // Время по подписям команд.
+    long resolvedFrames = 0; // Кадров, для которых получены результаты.
+    long droppedFrames = 0; // Кадров, результаты которых не успели к повторному использованию запросов.
+    long minLatency = 0, maxLatency = 0; // Через сколько кадров после постановки были прочитаны результаты.
+
+    GpuTimer() = default;
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+    ~GpuTimer() { for (FrameQueries& f : ring) if (!f.queries.empty()) glDeleteQueries((GLsizei)f.queries.size(), f.queries.data()); }
+
+    bool isSupported() const { return supported; }
+
+    // Начало кадра: читаются результаты кадра, запросы которого сейчас будут переиспользованы.
+    void beginFrame() {
+        if (!checked) { checked = true; supported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query; }
+        if (!supported) return;
+        frameIndex++;
+        resolve(ring[frameIndex % Frames]);
+        ring[frameIndex % Frames].frame = frameIndex;
+    }
+    // Метка времени GPU. label - подпись работы, выполненной после предыдущей метки (nullptr для первой метки кадра).
+    // Строка подписи должна жить, пока результаты не прочитаны.
+    void stamp(const char* label) {
+        if (!supported || frameIndex < 0) return;
+        FrameQueries& f = ring[frameIndex % Frames];
+        if (f.used == f.queries.size()) { GLuint id = 0; glGenQueries(1, &id); f.queries.push_back(id); f.labels.push_back(nullptr); }
+        if (f.used > 0) f.labels[f.used - 1] = label;
+        glQueryCounter(f.queries[f.used++], GL_TIMESTAMP);
+    }
+    void reset() { results.clear(); resolvedFrames = droppedFrames = minLatency = maxLatency = 0; }
+
+    void printSummary(std::ostream& out) const { // Среднее время GPU на одну команду по каждой подписи.
+        if (!supported) { out << "GPU timer queries are not supported\n"; return; }
+        out << "GPU time by model (" << resolvedFrames << " frames read " << minLatency << "-" << maxLatency
+            << " frames late, " << droppedFrames << " dropped):\n" << std::fixed << std::setprecision(4);
+        for (const auto& entry : results)
+            out << "  " << std::left << std::setw(24) << entry.first << std::right << std::setw(10)
+                << entry.second.ms / entry.second.samples << " ms/draw, " << entry.second.samples << " draws\n";
+    }
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Индекс, разделяющий полосы треугольников в одном буфере (glPrimitiveRestartIndex).
+// При упаковке в 8 или 16 бит заменяется наибольшим значением типа (restartIndexFor).
+const GLuint PRIMITIVE_RESTART_INDEX = 0xFFFFFFFFu;
+
+// Наибольшее число вершин в мешлете с 16-битными индексами (0xFFFF зарезервирован для перезапуска примитива).
+const GLuint MESHLET_MAX_VERTICES = 0xFFFF;
+
+// Размер одного индекса типа type в байтах.
+inline size_t indexSize(GLenum type) {
+    return type == GL_UNSIGNED_BYTE ? 1 : type == GL_UNSIGNED_SHORT ? 2 : 4;
+}
+
+// Индекс перезапуска примитива для типа индексов (все биты единицы).
+inline GLuint restartIndexFor(GLenum type) {
+    return type == GL_UNSIGNED_BYTE ? 0xFFu : type == GL_UNSIGNED_SHORT ? 0xFFFFu : PRIMITIVE_RESTART_INDEX;
+}
+
+// Самый узкий тип, в который помещаются индексы до maxIndex включительно (наибольшее значение типа занято перезапуском).
+inline GLenum indexTypeFor(GLuint maxIndex) {
+    if (maxIndex < 0xFFu) return GL_UNSIGNED_BYTE;
+    if (maxIndex < 0xFFFFu) return GL_UNSIGNED_SHORT;
+    return GL_UNSIGNED_INT;
+}
+
+// Наибольший индекс вершины без учета PRIMITIVE_RESTART_INDEX (0 для пустого списка).
+inline GLuint maxVertexIndex(const std::vector<GLuint>& indices) {
+    GLuint maxIndex = 0;
+    for (GLuint index : indices) if (index != PRIMITIVE_RESTART_INDEX) maxIndex = std::max(maxIndex, index);
+    return maxIndex;
+}
+
+// Функция упаковывает индексы в тип type, вычитая baseVertex (для мешлетов), и возвращает байты для glBufferData.
+// PRIMITIVE_RESTART_INDEX переводится в индекс перезапуска нового типа.
+inline std::vector<uint8_t> packIndices(const GLuint* indices, size_t count, GLenum type, GLuint baseVertex = 0) {
+    std::vector<uint8_t> bytes(count * indexSize(type));
+    GLuint restart = restartIndexFor(type);
+    for (size_t i = 0; i < count; ++i) {
+        GLuint index = indices[i] == PRIMITIVE_RESTART_INDEX ? restart : indices[i] - baseVertex;
+        if (type == GL_UNSIGNED_BYTE) bytes[i] = (uint8_t)index;
+        else if (type == GL_UNSIGNED_SHORT) { uint16_t value = (uint16_t)index; memcpy(&bytes[2 * i], &value, 2); }
+        else memcpy(&bytes[4 * i], &index, 4);
+    }
+    return bytes;
+}
+
+// Функция, обратная packIndices: читает count индексов типа type (индекс перезапуска типа становится PRIMITIVE_RESTART_INDEX).
+inline std::vector<GLuint> unpackIndices(const void* data, size_t count, GLenum type) {
+    std::vector<GLuint> indices(count);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    GLuint restart = restartIndexFor(type);
+    for (size_t i = 0; i < count; ++i) {
+        GLuint index;
+        if (type == GL_UNSIGNED_BYTE) index = bytes[i];
+        else if (type == GL_UNSIGNED_SHORT) { uint16_t value; memcpy(&value, bytes + 2 * i, 2); index = value; }
+        else memcpy(&index, bytes + 4 * i, 4);
+        indices[i] = index == restart ? PRIMITIVE_RESTART_INDEX : index;
+    }
+    return indices;
+}
+
+// Участок списка треугольников, индексы которого лежат в пределах MESHLET_MAX_VERTICES вершин от baseVertex.
+struct Meshlet {
+    GLuint firstIndex = 0, indexCount = 0;
+    GLint baseVertex = 0;
+};
+
+// Функция делит список треугольников на мешлеты по порядку: треугольник добавляется к текущему мешлету,
+// пока диапазон его вершин не превышает MESHLET_MAX_VERTICES, иначе начинается новый мешлет.
+// Вершины не копируются, поэтому деление выгодно только при локальном порядке вершин (сетки генератора,
+// optimizeVertexFetch); при случайном порядке мешлетов получится много, и вызывающий код может от них отказаться.
+inline std::vector<Meshlet> splitMeshlets(const std::vector<GLuint>& indices) {
+    std::vector<Meshlet> meshlets;
+    GLuint low = 0, high = 0;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        GLuint triLow = std::min({ indices[t], indices[t + 1], indices[t + 2] });
+        GLuint triHigh = std::max({ indices[t], indices[t + 1], indices[t + 2] });
+        GLuint newLow = std::min(low, triLow), newHigh = std::max(high, triHigh);
+        if (meshlets.empty() || newHigh - newLow >= MESHLET_MAX_VERTICES) {
+            meshlets.push_back({ (GLuint)t, 0, 0 });
+            newLow = triLow; newHigh = triHigh;
+        }
+        low = newLow; high = newHigh;
+        meshlets.back().indexCount += 3;
+        meshlets.back().baseVertex = (GLint)low;
+    }
+    return meshlets;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "gl_buffer.h"
+#include "draw_queue.h"
+#include "index_buffer.h"
+#include "stream_buffer.h"
+#include "vertex_format.h"
+
+// Общий буфер вершин и индексов для множества небольших мешей одного формата (InterleavedVertex).
+// Все меши лежат в одном VAO, а выбранные для кадра рисуются одной командой очереди:
+// glMultiDrawElementsIndirect при поддержке GL 4.3 / ARB_multi_draw_indirect, иначе glMultiDrawElementsBaseVertex.
+// Число вызовов отрисовки поэтому не зависит от числа объектов.
+// Каждый submit получает свой набор, а команды пишутся в потоковый буфер (StreamBuffer), поэтому за кадр
+// набор можно ставить в очередь несколько раз, не затирая команды, которые GPU еще не прочитал.
+class MeshArena {
+private:
+    struct Mesh { GLuint firstIndex, indexCount; GLint baseVertex; };
+    CpuMesh geometry; // Данные на стороне CPU (после upload() остаются для бэкендов, рисующих на CPU).
+    std::vector<Mesh> meshes;
+    std::vector<DrawElementsIndirectCommand> commands; // Команды текущего кадра.
+    GLVertexArray vao;
+    GLBuffer vertexBuffer, indexBuffer;
+    std::unique_ptr<StreamBuffer> indirectStream; // Команды glMultiDrawElementsIndirect, часть буфера на кадр.
+    std::vector<std::unique_ptr<StreamBuffer>> retiredStreams; // Замененные буферы, на которые еще ссылаются наборы в очереди.
+    std::deque<MultiDrawBatch> batches; // Наборы с последней отправки очереди (deque не перемещает элементы при добавлении).
+    unsigned long batchesFlush = 0; // DrawQueue::flushes на момент создания batches.
+    bool indirectSupported = false;
+    GLenum indexType = GL_UNSIGNED_INT; // Тип индексов в видеопамяти, выбирается в upload() по наибольшему индексу меша.
+public:
+    const char* name = "mesh arena"; // Подпись набора в замерах времени GPU.
+    MeshArena() { indirectSupported = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect; }
+
+    // Добавление блока вершин, возвращает номер первой вершины (baseVertex) для addMesh.
+    GLint addVertices(const std::vector<glm::vec3>& coords, const std::vector<glm::vec3>& colors) {
+        GLint baseVertex = (GLint)geometry.vertices.size();
+        for (size_t i = 0; i < coords.size(); ++i) geometry.vertices.push_back({ coords[i], colors[i] });
+        return baseVertex;
+    }
+    // Добавление меша из индексов относительно baseVertex, возвращает его номер для draw().
+    size_t addMesh(GLint baseVertex, const std::vector<GLuint>& meshIndices) {
+        meshes.push_back({ (GLuint)geometry.indices.size(), (GLuint)meshIndices.size(), baseVertex });
+        geometry.indices.insert(geometry.indices.end(), meshIndices.begin(), meshIndices.end());
+        return meshes.size() - 1;
+    }
+    // Загрузка всех добавленных вершин и индексов в видеопамять (по одному glBufferData на буфер).
+    // Индексы мешей отсчитываются от baseVertex, поэтому обычно помещаются в 8 или 16 бит.
+    void upload() {
+        vao.bind();
+        vertexBuffer.upload(GL_ARRAY_BUFFER, geometry.vertices.data(), geometry.vertices.size() * sizeof(InterleavedVertex));
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(InterleavedVertex), (void*)offsetof(InterleavedVertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(InterleavedVertex), (void*)offsetof(InterleavedVertex, color));
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        indexType = indexTypeFor(maxVertexIndex(geometry.indices));
+        std::vector<uint8_t> packed = packIndices(geometry.indices.data(), geometry.indices.size(), indexType);
+        indexBuffer.upload(GL_ELEMENT_ARRAY_BUFFER, packed.data(), packed.size());
+    }
+
+    void draw(size_t mesh) { // Добавление меша в набор текущего кадра.
+        const Mesh& m = meshes[mesh];
+        commands.push_back({ m.indexCount, 1, m.firstIndex, m.baseVertex, 0 });
+    }
+    // Постановка набора в очередь одной командой и очистка набора для следующего кадра.
+    void submit(GLuint program, GLenum mode) {
+        if (drawQueue().flushes != batchesFlush) { // Наборы прошлой отправки нарисованы: их память и часть буфера команд свободны.
+            batches.clear();
+            retiredStreams.clear();
+            batchesFlush = drawQueue().flushes;
+            if (indirectStream) { indirectStream->endFrame(); indirectStream->beginFrame(); }
+        }
+        batches.emplace_back();
+        MultiDrawBatch& batch = batches.back();
+        batch.drawCount = (GLsizei)commands.size();
+        bool cpu = drawQueue().backend->usesCpuGeometry(); // Бэкенду на CPU нужны массивы набора, а не буфер команд.
+        if (!indirectSupported || cpu || !writeIndirect(batch)) {
+            for (const DrawElementsIndirectCommand& c : commands) {
+                batch.counts.push_back((GLsizei)c.count);
+                batch.offsets.push_back((const void*)(c.firstIndex * indexSize(indexType)));
+                batch.baseVertices.push_back(c.baseVertex);
+            }
+        }
+        drawQueue().pushBatch(program, vao.get(), mode, batch, name, indexType, nullptr, &geometry);
+        commands.clear();
+    }
+
+    // Отрисовка каждого меша набора отдельным вызовом glDrawElementsBaseVertex (для сравнения в замерах).
+    void submitSeparately(GLuint program, GLenum mode) {
+        glState().useProgram(program);
+        vao.bind();
+        for (const DrawElementsIndirectCommand& c : commands)
+            glDrawElementsBaseVertex(mode, (GLsizei)c.count, indexType, (void*)(c.firstIndex * indexSize(indexType)), c.baseVertex);
+        commands.clear();
+    }
+    bool usesIndirect() const { return indirectSupported; }
+    size_t meshCount() const { return meshes.size(); }
+private:
+    // Запись команд набора в потоковый буфер. Если места в части кадра не хватает, буфер создается заново
+    // с запасом; старый живет до следующей отправки очереди.
+    bool writeIndirect(MultiDrawBatch& batch) {
+        size_t bytes = commands.size() * sizeof(DrawElementsIndirectCommand), offset = 0;
+        void* data = indirectStream ? indirectStream->allocate(bytes, offset, sizeof(DrawElementsIndirectCommand)) : nullptr;
+        if (!data) {
+            if (indirectStream) retiredStreams.push_back(std::move(indirectStream));
+            indirectStream.reset(new StreamBuffer());
+            indirectStream->create(std::max<size_t>(bytes * 4, 4096));
+            indirectStream->beginFrame();
+            data = indirectStream->allocate(bytes, offset, sizeof(DrawElementsIndirectCommand));
+            if (!data) return false;
+        }
+        memcpy(data, commands.data(), bytes);
+        indirectStream->unmap();
+        batch.indirectBuffer = indirectStream->get();
+        batch.indirectOffset = offset;
+        return true;
+    }
+};
@@ -0,0 +1,241 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // std::min и std::max не должны подменяться макросами windows.h.
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "index_buffer.h"
+#include "vertex_format.h"
+
+// Файл, отображенный в память только для чтения (mmap, в Windows - CreateFileMapping).
+// Страницы читаются с диска при первом обращении, поэтому данные можно передавать в glBufferData прямо из отображения.
+class MappedFile {
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    // Отображение файла целиком. Возвращает false, если файл не открылся или пуст (пустой файл отобразить нельзя).
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) { close(); return false; }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) { close(); return false; }
+        bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!bytes) { close(); return false; }
+        length = (size_t)size.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) { ::close(fd); return false; }
+        void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // Отображение остается действительным и после закрытия дескриптора.
+        if (data == MAP_FAILED) return false;
+        madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL); // Данные читаются один раз подряд: ядро читает с упреждением.
+        bytes = static_cast<const uint8_t*>(data);
+        length = (size_t)info.st_size;
+#endif
+        return true;
+    }
+    void close() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr; file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes) munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+        bytes = nullptr; length = 0;
+    }
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Двоичный формат сетки: заголовок MeshFileHeader, затем вершины в формате layout и индексы типа indexType.
+// Оба потока начинаются с границы MESH_FILE_ALIGNMENT байт, так что отображенный файл можно передавать в
+// glBufferData без копирования и разбора. Числа хранятся в порядке байтов little-endian (как в памяти x86 и ARM).
+const uint32_t MESH_FILE_MAGIC = 0x464D4743u; // "CGMF".
+const uint32_t MESH_FILE_VERSION = 1;
+const size_t MESH_FILE_ALIGNMENT = 64;
+
+struct MeshFileHeader {
+    uint32_t magic = MESH_FILE_MAGIC;
+    uint32_t version = MESH_FILE_VERSION;
+    uint32_t layout = 0; // VertexLayout вершин (кроме Split: все атрибуты в одном потоке).
+    uint32_t vertexStride = 0; // vertexStride(layout), для проверки.
+    uint64_t vertexCount = 0, vertexOffset = 0, vertexBytes = 0;
+    uint64_t indexCount = 0, indexOffset = 0, indexBytes = 0; // indexCount 0 - сетка рисуется без индексов.
+    uint32_t indexType = GL_UNSIGNED_INT; // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT или GL_UNSIGNED_INT (с индексом перезапуска типа).
+    uint32_t primitive = GL_TRIANGLES; // Режим отрисовки для Model::render.
+    float positionScale[3] = { 1.0f, 1.0f, 1.0f }, positionOffset[3] = { 0.0f, 0.0f, 0.0f }; // PositionTransform сжатых форматов.
+    uint32_t reserved[8] = {};
+};
+static_assert(sizeof(MeshFileHeader) == 128, "MeshFileHeader layout is part of the file format");
+
+// Сетка, загруженная из двоичного файла: заголовок и указатели на потоки внутри отображения.
+// Указатели действительны, пока объект открыт.
+class MeshFile {
+private:
+    MappedFile file;
+    MeshFileHeader head;
+public:
+    // Открытие и проверка файла. При ошибке выводит сообщение и возвращает false.
+    bool open(const std::string& path) {
+        if (!file.open(path)) { std::cerr << "ERROR: cannot map mesh file " << path << "\n"; return false; }
+        const char* error = nullptr;
+        if (file.size() < sizeof(MeshFileHeader)) error = "file is shorter than the header";
+        else {
+            memcpy(&head, file.data(), sizeof(head));
+            VertexLayout layout = (VertexLayout)head.layout;
+            auto inside = [&](uint64_t offset, uint64_t bytes) { return offset % MESH_FILE_ALIGNMENT == 0 && offset <= file.size() && bytes <= file.size() - offset; };
+            if (head.magic != MESH_FILE_MAGIC) error = "not a mesh file";
+            else if (head.version != MESH_FILE_VERSION) error = "unsupported version";
+            else if (head.layout < (uint32_t)VertexLayout::Interleaved || head.layout > (uint32_t)VertexLayout::Snorm16RGB10A2) error = "unknown vertex layout";
+            else if (head.vertexStride != vertexStride(layout) || head.vertexCount > file.size() || head.vertexBytes != head.vertexCount * head.vertexStride) error = "vertex stream size does not match the layout";
+            else if (head.indexType != GL_UNSIGNED_BYTE && head.indexType != GL_UNSIGNED_SHORT && head.indexType != GL_UNSIGNED_INT) error = "unknown index type";
+            else if (head.indexCount > file.size() || head.indexBytes != head.indexCount * indexSize(head.indexType)) error = "index stream size does not match the index type";
+            else if (!inside(head.vertexOffset, head.vertexBytes) || !inside(head.indexOffset, head.indexBytes)) error = "stream is misaligned or outside the file";
+            else if (head.primitive > GL_TRIANGLE_FAN) error = "unknown primitive"; // GL_POINTS (0) ... GL_TRIANGLE_FAN (6).
+        }
+        if (error) { std::cerr << "ERROR: mesh file " << path << ": " << error << "\n"; close(); return false; }
+        return true;
+    }
+    void close() { file.close(); }
+    const MeshFileHeader& header() const { return head; }
+    VertexLayout layout() const { return (VertexLayout)head.layout; }
+    PositionTransform transform() const {
+        PositionTransform transform;
+        transform.scale = glm::vec3(head.positionScale[0], head.positionScale[1], head.positionScale[2]);
+        transform.offset = glm::vec3(head.positionOffset[0], head.positionOffset[1], head.positionOffset[2]);
+        return transform;
+    }
+    const void* vertices() const { return file.data() + head.vertexOffset; }
+    const void* indices() const { return file.data() + head.indexOffset; }
+    size_t fileSize() const { return file.size(); }
+};
+
+// Функция записывает сетку в двоичный файл: вершины в формате layout (Split заменяется на Interleaved),
+// индексы в самом узком типе (indexTypeFor). При ошибке выводит сообщение и возвращает false.
+inline bool writeMeshFile(const std::string& path, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& colors,
+    const std::vector<GLuint>& indices, VertexLayout layout, GLenum primitive) {
+    if (layout == VertexLayout::Split) layout = VertexLayout::Interleaved;
+    MeshFileHeader head;
+    head.layout = (uint32_t)layout;
+    head.vertexStride = (uint32_t)vertexStride(layout);
+    head.primitive = primitive;
+    PositionTransform transform;
+    if (isCompactLayout(layout)) transform = quantizationTransform(positions);
+    for (int axis = 0; axis < 3; ++axis) { head.positionScale[axis] = transform.scale[axis]; head.positionOffset[axis] = transform.offset[axis]; }
+    auto align = [](uint64_t offset) { return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT; };
+    head.vertexCount = positions.size();
+    head.vertexBytes = head.vertexCount * head.vertexStride;
+    head.vertexOffset = align(sizeof(MeshFileHeader));
+    head.indexType = indexTypeFor(maxVertexIndex(indices));
+    head.indexCount = indices.size();
+    head.indexBytes = head.indexCount * indexSize(head.indexType);
+    head.indexOffset = align(head.vertexOffset + head.vertexBytes);
+
+    std::vector<uint8_t> vertexData((size_t)head.vertexBytes);
+    packVertices(positions, colors, layout, transform, vertexData.data());
+    std::vector<uint8_t> indexData = packIndices(indices.data(), indices.size(), head.indexType);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    const char padding[MESH_FILE_ALIGNMENT] = {};
+    out.write((const char*)&head, sizeof(head));
+    out.write(padding, (std::streamsize)(head.vertexOffset - sizeof(head)));
+    out.write((const char*)vertexData.data(), (std::streamsize)vertexData.size());
+    out.write(padding, (std::streamsize)(head.indexOffset - head.vertexOffset - head.vertexBytes));
+    out.write((const char*)indexData.data(), (std::streamsize)indexData.size());
+    if (!out) { std::cerr << "ERROR: cannot write mesh file " << path << "\n"; return false; }
+    return true;
+}
+
+// Текстовое описание сетки для конвертера (--convert-mesh), по одной записи в строке:
+//   v x y z [r g b]   - вершина (цвет по умолчанию светло-серый, как у точек задания 1);
+//   i a b c ...       - индексы вершин с нуля (до 2^32 - 2), любое число в строке (-1 - перезапуск примитива);
+//   p triangles       - примитив: points, lines, line_strip, line_loop, triangles, triangle_strip, triangle_fan;
+//   # ...             - комментарий.
+struct TextMesh {
+    std::vector<glm::vec3> positions, colors;
+    std::vector<GLuint> indices;
+    GLenum primitive = GL_TRIANGLES;
+};
+
+// Функция разбирает текстовую сетку. При ошибке выводит сообщение с номером строки и возвращает false.
+inline bool readTextMesh(const std::string& path, TextMesh& mesh) {
+    static const struct { const char* name; GLenum mode; } primitives[] = {
+        { "points", GL_POINTS }, { "lines", GL_LINES }, { "line_strip", GL_LINE_STRIP }, { "line_loop", GL_LINE_LOOP },
+        { "triangles", GL_TRIANGLES }, { "triangle_strip", GL_TRIANGLE_STRIP }, { "triangle_fan", GL_TRIANGLE_FAN } };
+    std::ifstream in(path);
+    if (!in) { std::cerr << "ERROR: cannot open " << path << "\n"; return false; }
+    mesh = TextMesh();
+    std::string line;
+    size_t lineNumber = 0;
+    auto fail = [&](const char* message) { std::cerr << "ERROR: " << path << ":" << lineNumber << ": " << message << "\n"; return false; };
+    while (std::getline(in, line)) {
+        lineNumber++;
+        const char* p = line.c_str();
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#' || *p == '\r') continue;
+        char kind = *p++;
+        char* end = nullptr;
+        if (kind == 'v') {
+            float values[6] = { 0.0f, 0.0f, 0.0f, 0.8f, 0.8f, 0.8f };
+            int count = 0;
+            for (; count < 6; ++count, p = end) { values[count] = strtof(p, &end); if (end == p) break; }
+            if (count != 3 && count != 6) return fail("vertex needs 3 coordinates and optionally 3 color components");
+            mesh.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+            mesh.colors.push_back(glm::vec3(values[3], values[4], values[5]));
+        }
+        else if (kind == 'i') {
+            for (;; p = end) {
+                long long index = strtoll(p, &end, 10); // long в Windows 32-битный.
+                if (end == p) break;
+                if (index < -1 || index >= (long long)PRIMITIVE_RESTART_INDEX) return fail("index is out of range");
+                mesh.indices.push_back(index < 0 ? PRIMITIVE_RESTART_INDEX : (GLuint)index);
+            }
+        }
+        else if (kind == 'p') {
+            while (*p == ' ' || *p == '\t') p++;
+            std::string name(p);
+            while (!name.empty() && (name.back() == ' ' || name.back() == '\t' || name.back() == '\r')) name.pop_back();
+            bool found = false;
+            for (const auto& primitive : primitives) if (name == primitive.name) { mesh.primitive = primitive.mode; found = true; }
+            if (!found) return fail("unknown primitive");
+        }
+        else return fail("expected 'v', 'i', 'p' or '#'");
+    }
+    for (GLuint index : mesh.indices)
+        if (index != PRIMITIVE_RESTART_INDEX && index >= mesh.positions.size()) { std::cerr << "ERROR: " << path << ": index " << index << " refers to a missing vertex\n"; return false; }
+    return true;
+}
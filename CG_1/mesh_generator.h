@@ -0,0 +1,190 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "hash.h"
+
+// Сгенерированная геометрия: позиции вершин и индексы треугольников (GL_TRIANGLES).
+struct MeshData {
+    std::vector<glm::vec3> positions;
+    std::vector<GLuint> indices;
+    void clear() { positions.clear(); indices.clear(); } // Память остается выделенной для следующей генерации.
+};
+
+// Виды фигур для кэша MeshGenerator::cached.
+enum class MeshShape { Polygon = 1, Disc, Ring, Grid, Sphere, Torus };
+
+// Функция записывает n точек единичной окружности (cos, sin) с шагом 2pi/n, начиная с угла 0.
+// Точки получаются поворотом предыдущей на шаг (умножение комплексных чисел), а не вызовом sin/cos на каждую точку;
+// каждые 256 точек поворот начинается заново с точного значения, чтобы ошибка не накапливалась.
+inline void writeUnitCircle(glm::vec2* out, int n) {
+    const double step = 2.0 * 3.14159265358979323846 / n;
+    const double c = std::cos(step), s = std::sin(step);
+    for (int start = 0; start < n; start += 256) {
+        double x = std::cos(start * step), y = std::sin(start * step);
+        int end = std::min(n, start + 256);
+        for (int i = start; i < end; ++i) {
+            out[i] = glm::vec2((float)x, (float)y);
+            double nx = x * c - y * s;
+            y = x * s + y * c; x = nx;
+        }
+    }
+}
+
+// Генератор сеток для процедурных фигур. Таблицы точек окружности кэшируются по числу сегментов,
+// а фигуры дописываются в переданный MeshData (индексы считаются от его текущего конца),
+// поэтому один MeshData может служить общим хранилищем для многих фигур и переиспользоваться без выделений.
+// cached() дополнительно запоминает готовые фигуры по параметрам.
+class MeshGenerator {
+private:
+    struct Key { // Параметры фигуры для кэша (без выравнивающих пропусков, сравнивается побайтно).
+        int shape, a, b;
+        float x, y;
+    };
+    std::unordered_map<int, std::vector<glm::vec2>> circles; // Точки окружности по числу сегментов.
+    std::unordered_map<uint64_t, std::pair<Key, std::shared_ptr<const MeshData>>> meshes;
+
+    static std::pair<glm::vec3*, GLuint> grow(MeshData& out, size_t vertices, size_t indices, GLuint*& index) {
+        GLuint base = (GLuint)out.positions.size();
+        size_t firstIndex = out.indices.size();
+        out.positions.resize(out.positions.size() + vertices);
+        out.indices.resize(out.indices.size() + indices);
+        index = out.indices.data() + firstIndex;
+        return { out.positions.data() + base, base };
+    }
+    static GLuint* quad(GLuint* index, GLuint a, GLuint b, GLuint c, GLuint d) { // Четырехугольник a-b-c-d двумя треугольниками.
+        index[0] = a; index[1] = b; index[2] = c; index[3] = c; index[4] = b; index[5] = d;
+        return index + 6;
+    }
+public:
+    size_t hits = 0, misses = 0; // Статистика cached().
+
+    // Таблица из n точек единичной окружности (вычисляется один раз для каждого n).
+    const std::vector<glm::vec2>& circle(int n) {
+        std::vector<glm::vec2>& table = circles[n];
+        if (table.empty()) { table.resize(n); writeUnitCircle(table.data(), n); }
+        return table;
+    }
+
+    // Правильный n-угольник радиуса r с вершинами на окружности, индексы - веер треугольников из вершины 0.
+    void polygon(MeshData& out, int n, float r) {
+        const std::vector<glm::vec2>& table = circle(n);
+        GLuint* index;
+        auto [vertex, base] = grow(out, n, n >= 3 ? 3 * (size_t)(n - 2) : 0, index);
+        for (int i = 0; i < n; ++i) vertex[i] = glm::vec3(r * table[i], 0.0f);
+        for (int i = 1; i + 1 < n; ++i) { *index++ = base; *index++ = base + i; *index++ = base + i + 1; }
+    }
+    // Круг радиуса r: центр и rings концентрических колец по segments вершин (1 + segments * rings вершин).
+    void disc(MeshData& out, int segments, int rings, float r) {
+        const std::vector<glm::vec2>& table = circle(segments);
+        GLuint* index;
+        auto [vertex, base] = grow(out, 1 + (size_t)segments * rings, (size_t)segments * (3 + 6 * (rings - 1)), index);
+        *vertex++ = glm::vec3(0.0f);
+        for (int ring = 1; ring <= rings; ++ring) {
+            float radius = r * ring / rings;
+            for (int i = 0; i < segments; ++i) *vertex++ = glm::vec3(radius * table[i], 0.0f);
+        }
+        for (int i = 0; i < segments; ++i) { *index++ = base; *index++ = base + 1 + i; *index++ = base + 1 + (i + 1) % segments; }
+        for (int ring = 1; ring < rings; ++ring) {
+            GLuint inner = base + 1 + (ring - 1) * segments, outer = inner + segments;
+            for (int i = 0; i < segments; ++i) {
+                int next = (i + 1) % segments;
+                index = quad(index, inner + i, outer + i, inner + next, outer + next);
+            }
+        }
+    }
+    // Кольцо между радиусами inner и outer из segments сегментов.
+    void ring(MeshData& out, int segments, float inner, float outer) {
+        const std::vector<glm::vec2>& table = circle(segments);
+        GLuint* index;
+        auto [vertex, base] = grow(out, 2 * (size_t)segments, 6 * (size_t)segments, index);
+        for (int i = 0; i < segments; ++i) { vertex[2 * i] = glm::vec3(inner * table[i], 0.0f); vertex[2 * i + 1] = glm::vec3(outer * table[i], 0.0f); }
+        for (int i = 0; i < segments; ++i) {
+            GLuint a = base + 2 * i, b = base + 2 * ((i + 1) % segments);
+            index = quad(index, a, a + 1, b, b + 1);
+        }
+    }
+    // Прямоугольная сетка cols x rows клеток размером width x height с центром в начале координат.
+    void grid(MeshData& out, int cols, int rows, float width, float height) {
+        GLuint* index;
+        auto [vertex, base] = grow(out, (size_t)(cols + 1) * (rows + 1), 6 * (size_t)cols * rows, index);
+        for (int y = 0; y <= rows; ++y)
+            for (int x = 0; x <= cols; ++x) *vertex++ = glm::vec3(width * ((float)x / cols - 0.5f), height * ((float)y / rows - 0.5f), 0.0f);
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < cols; ++x) {
+                GLuint a = base + y * (cols + 1) + x, c = a + cols + 1;
+                index = quad(index, a, a + 1, c, c + 1);
+            }
+        }
+    }
+    // Сфера радиуса r из slices меридианов и stacks параллелей (на полюсах вершины совпадают).
+    void sphere(MeshData& out, int slices, int stacks, float r) {
+        const std::vector<glm::vec2>& around = circle(slices);
+        const std::vector<glm::vec2>& half = circle(2 * stacks); // Первые stacks + 1 точек - углы от 0 до pi.
+        GLuint* index;
+        auto [vertex, base] = grow(out, (size_t)slices * (stacks + 1), 6 * (size_t)slices * stacks, index);
+        for (int stack = 0; stack <= stacks; ++stack) {
+            glm::vec2 latitude = half[stack]; // (cos, sin) угла от северного полюса.
+            for (int i = 0; i < slices; ++i) *vertex++ = r * glm::vec3(latitude.y * around[i].x, latitude.x, latitude.y * around[i].y);
+        }
+        for (int stack = 0; stack < stacks; ++stack) {
+            for (int i = 0; i < slices; ++i) {
+                GLuint a = base + stack * slices, b = a + slices;
+                int next = (i + 1) % slices;
+                index = quad(index, a + i, b + i, a + next, b + next);
+            }
+        }
+    }
+    // Тор с радиусом R до центра трубки и радиусом трубки r: segments сечений по sides вершин.
+    void torus(MeshData& out, int segments, int sides, float R, float r) {
+        const std::vector<glm::vec2>& major = circle(segments);
+        const std::vector<glm::vec2>& minor = circle(sides);
+        GLuint* index;
+        auto [vertex, base] = grow(out, (size_t)segments * sides, 6 * (size_t)segments * sides, index);
+        for (int i = 0; i < segments; ++i)
+            for (int j = 0; j < sides; ++j) *vertex++ = glm::vec3((R + r * minor[j].x) * major[i], r * minor[j].y);
+        for (int i = 0; i < segments; ++i) {
+            GLuint a = base + i * sides, b = base + ((i + 1) % segments) * sides;
+            for (int j = 0; j < sides; ++j) {
+                int next = (j + 1) % sides;
+                index = quad(index, a + j, b + j, a + next, b + next);
+            }
+        }
+    }
+
+    // Фигура с заданными параметрами из кэша или сгенерированная и запомненная. Значение a, b, x, y зависит от shape:
+    // Polygon (n, -, r), Disc (segments, rings, r), Ring (segments, -, inner, outer), Grid (cols, rows, width, height),
+    // Sphere (slices, stacks, r), Torus (segments, sides, R, r).
+    std::shared_ptr<const MeshData> cached(MeshShape shape, int a, int b, float x, float y = 0.0f) {
+        Key key;
+        memset(&key, 0, sizeof(key));
+        key.shape = (int)shape; key.a = a; key.b = b; key.x = x; key.y = y;
+        uint64_t hash = hashBytes(&key, sizeof(key));
+        auto it = meshes.find(hash);
+        if (it != meshes.end() && memcmp(&it->second.first, &key, sizeof(key)) == 0) { hits++; return it->second.second; }
+        misses++;
+        auto mesh = std::make_shared<MeshData>();
+        switch (shape) {
+        case MeshShape::Polygon: polygon(*mesh, a, x); break;
+        case MeshShape::Disc: disc(*mesh, a, b, x); break;
+        case MeshShape::Ring: ring(*mesh, a, x, y); break;
+        case MeshShape::Grid: grid(*mesh, a, b, x, y); break;
+        case MeshShape::Sphere: sphere(*mesh, a, b, x); break;
+        case MeshShape::Torus: torus(*mesh, a, b, x, y); break;
+        }
+        meshes[hash] = { key, mesh };
+        return mesh;
+    }
+    void clearCache() { meshes.clear(); }
+};
+
+// Общий генератор приложения (используется только из потока отрисовки).
+inline MeshGenerator& meshGenerator() { static MeshGenerator generator; return generator; }
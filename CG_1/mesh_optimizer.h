@@ -0,0 +1,106 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "triangulator.h"
+
+// Размер модели кэша вершин после преобразования (FIFO), по которому считается ACMR.
+const size_t VERTEX_CACHE_SIZE = 16;
+
+// Порядок индексов до и после оптимизации.
+struct IndexOrderStats {
+    size_t triangles = 0;
+    double acmrBefore = 0.0, acmrAfter = 0.0; // Среднее число промахов кэша вершин на треугольник (от 0.5 до 3).
+    bool optimized = false;
+};
+
+// Функция моделирует FIFO-кэш вершин размера cacheSize на списке треугольников и возвращает ACMR
+// (average cache miss ratio): число обработанных вершинным шейдером вершин на один треугольник.
+// Имеет смысл только для списка треугольников; для полос с PRIMITIVE_RESTART_INDEX возвращает 0.
+inline double computeACMR(const std::vector<GLuint>& indices, size_t cacheSize = VERTEX_CACHE_SIZE) {
+    if (indices.size() < 3 || std::find(indices.begin(), indices.end(), PRIMITIVE_RESTART_INDEX) != indices.end()) return 0.0;
+    GLuint maxIndex = *std::max_element(indices.begin(), indices.end());
+    std::vector<size_t> stamp((size_t)maxIndex + 1, 0); // Номер промаха, на котором вершина попала в кэш.
+    size_t time = cacheSize + 1, misses = 0;
+    for (GLuint index : indices) {
+        if (time - stamp[index] > cacheSize) { stamp[index] = time++; misses++; }
+    }
+    return (double)misses / (indices.size() / 3);
+}
+
+// Функция переупорядочивает треугольники для локальности кэша вершин (алгоритм Tipsify, Sander и др. 2007):
+// треугольники выдаются веерами вокруг вершины, а следующей выбирается соседняя вершина, которая еще
+// останется в кэше, с наибольшим временем жизни в нем; в тупике берется последняя выданная вершина с оставшимися треугольниками.
+// Работает за линейное время. Набор треугольников и их ориентация не меняются.
+inline std::vector<GLuint> optimizeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount, size_t cacheSize = VERTEX_CACHE_SIZE) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<GLuint> result;
+    result.reserve(triangleCount * 3);
+    // Списки треугольников каждой вершины в сжатом виде (смещения + общий массив).
+    std::vector<GLuint> offsets(vertexCount + 1, 0), live(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) live[indices[i]]++;
+    for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + live[v];
+    std::vector<GLuint> adjacency(offsets[vertexCount]), fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+        for (int k = 0; k < 3; ++k) adjacency[fill[indices[3 * t + k]]++] = (GLuint)t;
+
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<GLuint> deadEnd, candidates;
+    size_t time = cacheSize + 1, cursor = 0;
+    long fanning = vertexCount ? 0 : -1;
+    while (fanning >= 0) {
+        candidates.clear();
+        for (GLuint a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+            GLuint t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = true;
+            for (int k = 0; k < 3; ++k) {
+                GLuint v = indices[3 * t + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize) cacheTime[v] = time++;
+            }
+        }
+        // Следующая вершина веера: из кандидатов, которая к концу своего веера еще будет в кэше и дольше всех в нем находится.
+        long best = -1, bestPriority = -1;
+        for (GLuint v : candidates) {
+            if (live[v] == 0) continue;
+            long priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize) priority = (long)(time - cacheTime[v]);
+            if (priority > bestPriority) { bestPriority = priority; best = v; }
+        }
+        if (best < 0) { // Тупик: недавно выданные вершины, затем любая вершина с оставшимися треугольниками.
+            while (!deadEnd.empty() && best < 0) { GLuint v = deadEnd.back(); deadEnd.pop_back(); if (live[v] > 0) best = v; }
+            while (best < 0 && cursor < vertexCount) { if (live[cursor] > 0) best = (long)cursor; else cursor++; }
+        }
+        fanning = best;
+    }
+    return result;
+}
+
+// Функция нумерует вершины в порядке первого использования индексами (локальность выборки вершин),
+// переписывает indices и возвращает таблицу remap[старый номер] = новый номер. Неиспользуемые вершины идут в конец.
+inline std::vector<GLuint> optimizeVertexFetch(std::vector<GLuint>& indices, size_t vertexCount) {
+    const GLuint unused = 0xFFFFFFFFu;
+    std::vector<GLuint> remap(vertexCount, unused);
+    GLuint next = 0;
+    for (GLuint& index : indices) {
+        if (remap[index] == unused) remap[index] = next++;
+        index = remap[index];
+    }
+    for (GLuint& r : remap) if (r == unused) r = next++;
+    return remap;
+}
+
+// Функция переставляет атрибуты вершин по таблице remap из optimizeVertexFetch.
+template <typename T>
+void remapVertices(std::vector<T>& vertices, const std::vector<GLuint>& remap) {
+    std::vector<T> result(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) result[remap[i]] = vertices[i];
+    vertices.swap(result);
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <system_error>
+
+#include <GL/glew.h>
+
+#include "hash.h"
+
+// Функция проверяет статус компиляции шейдера и выводит журнал ошибок. Возвращает true при успехе.
+inline bool checkShaderCompiled(GLuint shader, const char* kind) {
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_TRUE) return true;
+    GLint length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    std::string log(length > 0 ? length : 1, '\0');
+    glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, &log[0]);
+    std::cerr << "ERROR: " << kind << " shader compilation failed:\n" << log.c_str() << "\n";
+    return false;
+}
+
+// Функция проверяет статус линковки программы и выводит журнал ошибок. Возвращает true при успехе.
+inline bool checkProgramLinked(GLuint program, bool logErrors = true) {
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_TRUE || !logErrors) return status == GL_TRUE;
+    GLint length = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    std::string log(length > 0 ? length : 1, '\0');
+    glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, &log[0]);
+    std::cerr << "ERROR: shader program link failed:\n" << log.c_str() << "\n";
+    return false;
+}
+
+// Явные номера атрибутов, которые привязываются ко всем программам до компоновки. Привязки сохраняются в бинарном
+// коде программы, поэтому таблица входит в ключ ShaderCache: после ее изменения старые файлы кэша не подходят.
+struct ShaderAttribute { GLuint location; const char* name; };
+constexpr ShaderAttribute SHADER_ATTRIBUTES[] = {
+    { 0, "vertex_position" }, { 1, "vertex_color" }, // Model.
+    { 2, "instance_offset" }, { 3, "instance_scale" }, { 4, "instance_color" }, // Атрибуты экземпляров (шейдер инстансинга).
+    { 5, "point_prev" }, { 6, "point_a" }, { 7, "point_b" }, { 8, "point_next" }, { 9, "color_a" }, { 10, "color_b" } }; // ThickPolyline (LINE_ATTRIBUTE_*).
+const GLuint NO_SHADER_ATTRIBUTE = 0xFFFFFFFFu;
+
+// Номер атрибута name из SHADER_ATTRIBUTES (NO_SHADER_ATTRIBUTE, если его нет). Вычисляется при компиляции,
+// чтобы константы атрибутов в других файлах брались из таблицы, а не повторялись вручную.
+constexpr GLuint shaderAttributeLocation(const char* name) {
+    for (const ShaderAttribute& attribute : SHADER_ATTRIBUTES) {
+        size_t i = 0;
+        while (attribute.name[i] != '\0' && attribute.name[i] == name[i]) ++i;
+        if (attribute.name[i] == name[i]) return attribute.location;
+    }
+    return NO_SHADER_ATTRIBUTE;
+}
+
+// Функция компилирует шейдеры из строк и линкует их в одну программу. При ошибке возвращает 0.
+// Если retrievable = true, драйверу сообщается, что бинарный код программы будет запрошен для кэша.
+inline GLuint createShaderProgram(const char* vertex_shader_src, const char* fragment_shader_src, bool retrievable = false) {
+    GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vs, 1, &vertex_shader_src, NULL);
+    glCompileShader(vs);
+    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fs, 1, &fragment_shader_src, NULL);
+    glCompileShader(fs);
+    bool compiled = checkShaderCompiled(vs, "vertex") & checkShaderCompiled(fs, "fragment");
+    GLuint shader_program = glCreateProgram();
+    glAttachShader(shader_program, fs);
+    glAttachShader(shader_program, vs);
+    for (const ShaderAttribute& attribute : SHADER_ATTRIBUTES) glBindAttribLocation(shader_program, attribute.location, attribute.name);
+    if (retrievable) glProgramParameteri(shader_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(shader_program);
+    glDeleteShader(vs); glDeleteShader(fs);
+    if (!compiled || !checkProgramLinked(shader_program)) { glDeleteProgram(shader_program); return 0; }
+    return shader_program;
+}
+
+// Кэш шейдерных программ. Программы ищутся по хэшу исходного текста шейдеров, привязок атрибутов и строк драйвера:
+// сначала в памяти, затем в каталоге на диске в виде бинарного кода glGetProgramBinary.
+// Если драйвер отвергает сохраненный бинарный код, программа компилируется заново и файл перезаписывается.
+class ShaderCache {
+private:
+    std::filesystem::path directory; // Каталог с сохраненными программами.
+    std::unordered_map<uint64_t, GLuint> programs; // Уже созданные в этом запуске программы.
+    bool binarySupported = false, supportChecked = false; // Поддерживает ли драйвер сохранение программ (ARB_get_program_binary).
+
+    uint64_t key(const char* vertex_shader_src, const char* fragment_shader_src) const {
+        std::string driver = std::string((const char*)glGetString(GL_VENDOR)) + (const char*)glGetString(GL_RENDERER) + (const char*)glGetString(GL_VERSION);
+        uint64_t hash = hashBytes(driver.data(), driver.size());
+        for (const ShaderAttribute& attribute : SHADER_ATTRIBUTES) {
+            hash = hashBytes(&attribute.location, sizeof(attribute.location), hash);
+            hash = hashBytes(attribute.name, strlen(attribute.name) + 1, hash);
+        }
+        hash = hashBytes(vertex_shader_src, strlen(vertex_shader_src) + 1, hash); // Вместе с нулевым символом, чтобы разделить строки.
+        return hashBytes(fragment_shader_src, strlen(fragment_shader_src) + 1, hash);
+    }
+    std::filesystem::path pathFor(uint64_t hash) const {
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+        return directory / name.str();
+    }
+    GLuint loadBinary(const std::filesystem::path& path) { // Загрузка программы с диска, 0 - если файла нет или он отвергнут.
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return 0;
+        GLenum format = 0;
+        file.read(reinterpret_cast<char*>(&format), sizeof(format));
+        std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!file.eof() || binary.empty()) return 0;
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, format, binary.data(), (GLsizei)binary.size());
+        if (checkProgramLinked(program, false)) return program;
+        std::cerr << "WARNING: cached shader binary " << path.filename().string() << " was rejected, recompiling\n";
+        glDeleteProgram(program);
+        return 0;
+    }
+    void saveBinary(GLuint program, const std::filesystem::path& path) const {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, NULL, &format, binary.data());
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        std::filesystem::path tmp = path; tmp += ".tmp"; // Запись через временный файл, чтобы не оставить недописанный кэш.
+        {
+            std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+            if (!file) { std::cerr << "WARNING: could not write shader cache to " << directory.string() << "\n"; return; }
+            file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+            file.write(binary.data(), binary.size());
+        }
+        std::filesystem::rename(tmp, path, error);
+    }
+public:
+    size_t hits = 0, misses = 0; // Количество программ, загруженных из кэша и скомпилированных заново.
+
+    explicit ShaderCache(std::filesystem::path dir = "shader_cache") : directory(std::move(dir)) {}
+    ~ShaderCache() { for (auto& entry : programs) glDeleteProgram(entry.second); }
+
+    void clear() { std::error_code error; std::filesystem::remove_all(directory, error); } // Удаление кэша с диска (холодный запуск).
+
+    // Возвращает программу для пары шейдеров: из памяти, с диска или после компиляции. При ошибке возвращает 0.
+    GLuint getProgram(const char* vertex_shader_src, const char* fragment_shader_src) {
+        if (!supportChecked) { // Проверку поддержки делаем при первом запросе, когда контекст OpenGL уже создан.
+            supportChecked = true;
+            GLint formats = 0;
+            if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            binarySupported = formats > 0;
+        }
+        uint64_t hash = key(vertex_shader_src, fragment_shader_src);
+        auto it = programs.find(hash);
+        if (it != programs.end()) return it->second;
+
+        std::filesystem::path path = pathFor(hash);
+        GLuint program = binarySupported ? loadBinary(path) : 0;
+        if (program) hits++;
+        else {
+            misses++;
+            program = createShaderProgram(vertex_shader_src, fragment_shader_src, binarySupported);
+            if (program && binarySupported) saveBinary(program, path);
+        }
+        if (program) programs[hash] = program;
+        return program;
+    }
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "spsc_queue.h"
+
+// Тройной буфер без блокировок: писатель заполняет свой буфер и публикует его, читатель всегда получает
+// последний опубликованный целиком снимок. Ни одна сторона не ждет другую.
+template <typename T>
+class TripleBuffer {
+private:
+    static const unsigned Fresh = 4; // Флаг в middle: в среднем буфере лежит еще не прочитанный снимок.
+    T buffers[3];
+    unsigned writeIndex = 0, readIndex = 2; // Буферы, принадлежащие писателю и читателю.
+    std::atomic<unsigned> middle{ 1 }; // Буфер для обмена (и флаг Fresh).
+public:
+    T& write() { return buffers[writeIndex]; } // Буфер писателя.
+    void publish() { writeIndex = middle.exchange(writeIndex | Fresh, std::memory_order_acq_rel) & 3; }
+    const T& read() { // Последний опубликованный снимок (только поток читателя).
+        if (middle.load(std::memory_order_relaxed) & Fresh) readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & 3;
+        return buffers[readIndex];
+    }
+};
+
+// Поток симуляции с фиксированным шагом. Только он меняет State: события из очереди применяются
+// через onEvent, затем состояние продвигается на step секунд через onStep и публикуется как снимок.
+// Поток отрисовки читает снимки через latest(), поэтому стабильность симуляции и задержка ввода не зависят от времени кадра.
+// Если задан предикат idle и он истинен, поток после шага засыпает до следующего события вместо пустых шагов.
+template <typename State, typename Event, size_t QueueCapacity = 256>
+class FixedStepSimulation {
+private:
+    State state; // Принадлежит потоку симуляции.
+    SpscQueue<Event, QueueCapacity> events;
+    TripleBuffer<State> snapshots;
+    std::function<void(State&, const Event&)> onEvent;
+    std::function<void(State&, float)> onStep;
+    std::function<bool(const State&)> idle;
+    std::thread thread;
+    std::atomic<bool> running{ false };
+    std::mutex wakeMutex;
+    std::condition_variable wakeup;
+    std::atomic<bool> sleeping{ false }; // Поток ждет события (post должен его разбудить).
+
+    void run() {
+        using clock = std::chrono::steady_clock;
+        const clock::duration period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(step));
+        clock::time_point next = clock::now();
+        while (running.load(std::memory_order_acquire)) {
+            Event event;
+            while (events.pop(event)) onEvent(state, event);
+            onStep(state, (float)step);
+            snapshots.write() = state;
+            snapshots.publish();
+            steps.fetch_add(1, std::memory_order_relaxed);
+            if (idle && sleepWhenIdle.load(std::memory_order_relaxed) && idle(state)) {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                sleeping.store(true);
+                std::atomic_thread_fence(std::memory_order_seq_cst); // Парный барьер в post: событие не будет пропущено.
+                wakeup.wait(lock, [&] { return !events.empty() || !running.load(std::memory_order_acquire); });
+                sleeping.store(false);
+                wakeups.fetch_add(1, std::memory_order_relaxed);
+                next = clock::now();
+                continue;
+            }
+            next += period;
+            clock::time_point now = clock::now();
+            if (now - next > period * 8) next = now; // После долгой паузы не догоняем пропущенные шаги.
+            std::this_thread::sleep_until(next);
+            wakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+public:
+    double step = 1.0 / 120.0; // Шаг симуляции в секундах.
+    std::atomic<long> steps{ 0 }; // Выполнено шагов.
+    std::atomic<long> wakeups{ 0 }; // Пробуждений потока (после ожидания события или следующего шага).
+    std::atomic<long> droppedEvents{ 0 }; // Событий, не поместившихся в очередь.
+    std::atomic<bool> sleepWhenIdle{ true }; // false - шаги идут всегда (для сравнения в замерах).
+
+    FixedStepSimulation() = default;
+    FixedStepSimulation(const FixedStepSimulation&) = delete;
+    FixedStepSimulation& operator=(const FixedStepSimulation&) = delete;
+    ~FixedStepSimulation() { stop(); }
+
+    void start(const State& initial, std::function<void(State&, const Event&)> eventHandler, std::function<void(State&, float)> stepHandler,
+        std::function<bool(const State&)> idlePredicate = nullptr) {
+        stop();
+        state = initial;
+        snapshots.write() = initial;
+        snapshots.publish();
+        onEvent = std::move(eventHandler); onStep = std::move(stepHandler); idle = std::move(idlePredicate);
+        running.store(true, std::memory_order_release);
+        thread = std::thread(&FixedStepSimulation::run, this);
+    }
+    void stop() {
+        running.store(false, std::memory_order_release);
+        { std::lock_guard<std::mutex> lock(wakeMutex); }
+        wakeup.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+    void post(const Event& event) { // Только из одного потока-писателя.
+        if (!events.push(event)) { droppedEvents.fetch_add(1, std::memory_order_relaxed); return; }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load()) { std::lock_guard<std::mutex> lock(wakeMutex); wakeup.notify_one(); }
+    }
+    const State& latest() { return snapshots.read(); } // Только из потока отрисовки.
+};
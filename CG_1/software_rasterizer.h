@@ -0,0 +1,324 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "draw_queue.h"
+#include "index_buffer.h"
+
+// Способ закрашивания программы: интерполяция цвета или цвет последней (провоцирующей) вершины примитива.
+enum class Shading { Smooth, Flat };
+
+// Программный растеризатор: бэкенд очереди отрисовки, не использующий OpenGL.
+// Команды рисуются из CpuMesh моделей. При отправке очереди вершины переводятся в оконные координаты,
+// примитивы раскладываются по плиткам TileSize x TileSize, а finish() растеризует плитки параллельно
+// (потоки берут плитки по очереди, примитивы внутри плитки идут в порядке отправки, поэтому результат
+// не зависит от числа потоков). Поддерживаются GL_POINTS, GL_LINES/LINE_STRIP/LINE_LOOP, GL_TRIANGLES/STRIP/FAN
+// с перезапуском примитива, режимы граней DrawState (GL_FILL/GL_LINE/GL_POINT, лицевые - против часовой стрелки),
+// размер и сглаживание точек, толщина линий и тест глубины GL_LESS. Инстансинг не поддерживается (skippedCommands).
+// Треугольник проверяется блоками по 8 пикселей: функции ребер, покрытие и глубина блока считаются
+// в простых циклах без ветвлений, которые компилятор переводит в SIMD, а запись пикселей идет отдельным проходом.
+class SoftwareRasterizer : public RenderBackend {
+public:
+    static const int TileSize = 64;
+private:
+    struct Vertex { glm::vec3 position; glm::vec4 color; }; // Оконные координаты (пиксели, глубина от 0 до 1) и цвет.
+    enum class Kind : uint8_t { Triangle, SmoothPoint };
+    struct Primitive {
+        Vertex v[3]; // SmoothPoint использует только v[0] (центр).
+        Kind kind = Kind::Triangle;
+        float radius = 0.0f; // Радиус сглаженной точки в пикселях.
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0; // Ограничивающий прямоугольник в буфере кадра [x0, x1) x [y0, y1).
+    };
+    int width = 0, height = 0, tilesX = 0, tilesY = 0;
+    std::vector<uint32_t> colors; // RGBA8, строка 0 - нижняя (как у glReadPixels).
+    std::vector<float> depths;
+    std::vector<Primitive> primitives; // Примитивы текущей отправки.
+    std::vector<Vertex> transformed; // Вершины команды в оконных координатах.
+    std::vector<GLuint> strip; // Номера вершин участка между перезапусками.
+    std::vector<std::vector<uint32_t>> bins; // Номера примитивов каждой плитки.
+    std::unordered_map<GLuint, Shading> shadings;
+    bool clearPending = false; // Очистка буферов выполняется плитками в finish().
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    long generation = 0; // Номер задания для рабочих потоков.
+    int busy = 0; // Рабочих потоков, еще не закончивших текущее задание.
+    bool stopping = false;
+    std::atomic<int> nextTile{ 0 };
+
+    static uint32_t pack(const glm::vec4& c) {
+        glm::vec4 v = glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f;
+        return (uint32_t)v.r | (uint32_t)v.g << 8 | (uint32_t)v.b << 16 | (uint32_t)v.a << 24;
+    }
+    static glm::vec4 unpack(uint32_t c) {
+        return glm::vec4(c & 0xFF, (c >> 8) & 0xFF, (c >> 16) & 0xFF, c >> 24) / 255.0f;
+    }
+    Vertex toWindow(const InterleavedVertex& v) const {
+        return { glm::vec3((v.position.x + 1.0f) * 0.5f * width, (v.position.y + 1.0f) * 0.5f * height, (v.position.z + 1.0f) * 0.5f), glm::vec4(v.color, 1.0f) };
+    }
+
+    void bin(Primitive& p, float minX, float minY, float maxX, float maxY) { // Отсечение прямоугольника и раскладка по плиткам.
+        p.x0 = std::max(0, (int)std::floor(minX)); p.y0 = std::max(0, (int)std::floor(minY));
+        p.x1 = std::min(width, (int)std::ceil(maxX) + 1); p.y1 = std::min(height, (int)std::ceil(maxY) + 1);
+        if (p.x0 >= p.x1 || p.y0 >= p.y1) return;
+        uint32_t id = (uint32_t)primitives.size();
+        primitives.push_back(p);
+        for (int ty = p.y0 / TileSize; ty <= (p.y1 - 1) / TileSize; ++ty)
+            for (int tx = p.x0 / TileSize; tx <= (p.x1 - 1) / TileSize; ++tx) bins[ty * tilesX + tx].push_back(id);
+    }
+    void addTriangle(const Vertex& a, const Vertex& b, const Vertex& c) {
+        Primitive p;
+        p.v[0] = a; p.v[1] = b; p.v[2] = c;
+        bin(p, std::min({ a.position.x, b.position.x, c.position.x }), std::min({ a.position.y, b.position.y, c.position.y }),
+            std::max({ a.position.x, b.position.x, c.position.x }), std::max({ a.position.y, b.position.y, c.position.y }));
+    }
+    void addLine(const Vertex& a, const Vertex& b, float lineWidth) { // Отрезок - прямоугольник толщиной lineWidth из двух треугольников.
+        glm::vec2 d = glm::vec2(b.position) - glm::vec2(a.position);
+        float length = glm::length(d);
+        if (length < 1e-6f) return;
+        glm::vec3 n(glm::vec2(-d.y, d.x) * (0.5f * std::max(lineWidth, 1.0f) / length), 0.0f);
+        Vertex a0 = a, a1 = a, b0 = b, b1 = b;
+        a0.position -= n; a1.position += n; b0.position -= n; b1.position += n;
+        addTriangle(a0, b0, b1);
+        addTriangle(a0, b1, a1);
+    }
+    void addPoint(const Vertex& v, float size, bool smooth) {
+        float half = 0.5f * std::max(size, 1.0f);
+        if (smooth) {
+            Primitive p;
+            p.kind = Kind::SmoothPoint;
+            p.v[0] = v; p.radius = half;
+            bin(p, v.position.x - half - 1.0f, v.position.y - half - 1.0f, v.position.x + half + 1.0f, v.position.y + half + 1.0f);
+            return;
+        }
+        Vertex corners[4] = { v, v, v, v };
+        corners[0].position += glm::vec3(-half, -half, 0.0f); corners[1].position += glm::vec3(half, -half, 0.0f);
+        corners[2].position += glm::vec3(half, half, 0.0f); corners[3].position += glm::vec3(-half, half, 0.0f);
+        addTriangle(corners[0], corners[1], corners[2]);
+        addTriangle(corners[0], corners[2], corners[3]);
+    }
+    // Треугольник a-b-c (c - провоцирующая вершина) в режиме граней, выбранном по его ориентации.
+    void addPolygon(Vertex a, Vertex b, Vertex c, bool flat, const DrawState& state) {
+        if (flat) a.color = b.color = c.color;
+        float area = (b.position.x - a.position.x) * (c.position.y - a.position.y) - (b.position.y - a.position.y) * (c.position.x - a.position.x);
+        GLenum mode = area >= 0.0f ? state.polygonFront : state.polygonBack;
+        if (mode == GL_FILL) addTriangle(a, b, c);
+        else if (mode == GL_LINE) { addLine(a, b, state.lineWidth); addLine(b, c, state.lineWidth); addLine(c, a, state.lineWidth); }
+        else { addPoint(a, state.pointSize, state.pointSmooth); addPoint(b, state.pointSize, state.pointSmooth); addPoint(c, state.pointSize, state.pointSmooth); }
+    }
+    // Сборка примитивов режима mode из участка strip (номера вершин в transformed без перезапусков).
+    void assemble(GLenum mode, bool flat, const DrawState& state) {
+        struct Fetch { const std::vector<Vertex>& vertices; const std::vector<GLuint>& ids; const Vertex& operator[](size_t i) const { return vertices[ids[i]]; } };
+        Fetch v{ transformed, strip };
+        size_t n = strip.size();
+        auto line = [&](size_t i, size_t j) {
+            if (!flat) { addLine(v[i], v[j], state.lineWidth); return; }
+            Vertex a = v[i]; a.color = v[j].color; // Провоцирующая вершина отрезка - вторая.
+            addLine(a, v[j], state.lineWidth);
+        };
+        switch (mode) {
+        case GL_POINTS: for (size_t i = 0; i < n; ++i) addPoint(v[i], state.pointSize, state.pointSmooth); break;
+        case GL_LINES: for (size_t i = 0; i + 1 < n; i += 2) line(i, i + 1); break;
+        case GL_LINE_STRIP: for (size_t i = 0; i + 1 < n; ++i) line(i, i + 1); break;
+        case GL_LINE_LOOP:
+            for (size_t i = 0; i + 1 < n; ++i) line(i, i + 1);
+            if (n > 2) line(n - 1, 0);
+            break;
+        case GL_TRIANGLES: for (size_t i = 0; i + 2 < n; i += 3) addPolygon(v[i], v[i + 1], v[i + 2], flat, state); break;
+        case GL_TRIANGLE_STRIP:
+            for (size_t i = 0; i + 2 < n; ++i) {
+                if (i % 2 == 0) addPolygon(v[i], v[i + 1], v[i + 2], flat, state);
+                else addPolygon(v[i + 1], v[i], v[i + 2], flat, state); // Нечетные треугольники полосы обходятся в обратном порядке.
+            }
+            break;
+        case GL_TRIANGLE_FAN: for (size_t i = 1; i + 1 < n; ++i) addPolygon(v[0], v[i], v[i + 1], flat, state); break;
+        default: break;
+        }
+    }
+
+    void rasterTriangle(const Primitive& p, int x0, int y0, int x1, int y1) {
+        const Vertex& a = p.v[0], & b = p.v[1], & c = p.v[2];
+        float area = (b.position.x - a.position.x) * (c.position.y - a.position.y) - (b.position.y - a.position.y) * (c.position.x - a.position.x);
+        if (area == 0.0f) return;
+        float inverse = 1.0f / area;
+        // Барицентрические веса вершин как линейные функции пикселя: w = A * x + B * y + C (неотрицательны внутри треугольника).
+        float A0 = (b.position.y - c.position.y) * inverse, B0 = (c.position.x - b.position.x) * inverse;
+        float A1 = (c.position.y - a.position.y) * inverse, B1 = (a.position.x - c.position.x) * inverse;
+        float A2 = (a.position.y - b.position.y) * inverse, B2 = (b.position.x - a.position.x) * inverse;
+        float C0 = -(A0 * b.position.x + B0 * b.position.y), C1 = -(A1 * c.position.x + B1 * c.position.y), C2 = -(A2 * a.position.x + B2 * a.position.y);
+        const int Block = 8;
+        float w0[Block], w1[Block], w2[Block], z[Block];
+        int covered[Block];
+        for (int y = y0; y < y1; ++y) {
+            float py = y + 0.5f;
+            float* depthRow = &depths[(size_t)y * width];
+            uint32_t* colorRow = &colors[(size_t)y * width];
+            for (int x = x0; x < x1; x += Block) {
+                int anyCovered = 0;
+                for (int k = 0; k < Block; ++k) {
+                    float px = x + k + 0.5f;
+                    w0[k] = A0 * px + B0 * py + C0;
+                    w1[k] = A1 * px + B1 * py + C1;
+                    w2[k] = A2 * px + B2 * py + C2;
+                    z[k] = w0[k] * a.position.z + w1[k] * b.position.z + w2[k] * c.position.z;
+                    covered[k] = (w0[k] >= 0.0f) & (w1[k] >= 0.0f) & (w2[k] >= 0.0f);
+                    anyCovered |= covered[k];
+                }
+                if (!anyCovered) continue;
+                int count = std::min(Block, x1 - x);
+                for (int k = 0; k < count; ++k) {
+                    if (!covered[k] || !(z[k] < depthRow[x + k])) continue;
+                    depthRow[x + k] = z[k];
+                    colorRow[x + k] = pack(w0[k] * a.color + w1[k] * b.color + w2[k] * c.color);
+                }
+            }
+        }
+    }
+    void rasterSmoothPoint(const Primitive& p, int x0, int y0, int x1, int y1) { // Покрытие по расстоянию до центра, смешивание по альфе.
+        const Vertex& v = p.v[0];
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                float distance = glm::length(glm::vec2(x + 0.5f, y + 0.5f) - glm::vec2(v.position));
+                float coverage = std::min(1.0f, p.radius + 0.5f - distance);
+                size_t i = (size_t)y * width + x;
+                if (coverage <= 0.0f || !(v.position.z < depths[i])) continue;
+                depths[i] = v.position.z;
+                colors[i] = pack(glm::mix(unpack(colors[i]), v.color, coverage * v.color.a));
+            }
+        }
+    }
+    void rasterTile(int tile) {
+        int tx = tile % tilesX, ty = tile / tilesX;
+        int x0 = tx * TileSize, y0 = ty * TileSize, x1 = std::min(width, x0 + TileSize), y1 = std::min(height, y0 + TileSize);
+        if (clearPending) {
+            for (int y = y0; y < y1; ++y) {
+                std::fill(colors.begin() + (size_t)y * width + x0, colors.begin() + (size_t)y * width + x1, clearColor);
+                std::fill(depths.begin() + (size_t)y * width + x0, depths.begin() + (size_t)y * width + x1, 1.0f);
+            }
+        }
+        for (uint32_t id : bins[tile]) {
+            const Primitive& p = primitives[id];
+            int px0 = std::max(x0, p.x0), py0 = std::max(y0, p.y0), px1 = std::min(x1, p.x1), py1 = std::min(y1, p.y1);
+            if (p.kind == Kind::Triangle) rasterTriangle(p, px0, py0, px1, py1);
+            else rasterSmoothPoint(p, px0, py0, px1, py1);
+        }
+    }
+    void rasterTiles() { // Выполняется всеми потоками: плитки раздаются счетчиком.
+        int tileCount = tilesX * tilesY;
+        for (int tile = nextTile.fetch_add(1); tile < tileCount; tile = nextTile.fetch_add(1)) rasterTile(tile);
+    }
+    void run() {
+        long seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            rasterTiles();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0) done.notify_one();
+        }
+    }
+public:
+    uint32_t clearColor = 0xFF000000u; // Цвет очистки RGBA8 (по умолчанию непрозрачный черный, как glClearColor в InitAll).
+    long skippedCommands = 0; // Команд, которые не удалось выполнить (нет CpuMesh или инстансинг).
+
+    // threads - число потоков растеризации вместе с вызывающим (0 - по числу ядер).
+    explicit SoftwareRasterizer(int threads = 0) {
+        if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 1; i < threads; ++i) workers.emplace_back(&SoftwareRasterizer::run, this);
+    }
+    SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+    SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+    ~SoftwareRasterizer() {
+        { std::lock_guard<std::mutex> lock(mutex); stopping = true; }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    int threadCount() const { return (int)workers.size() + 1; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const std::vector<uint32_t>& pixels() const { return colors; } // Результат последнего finish().
+    void setShading(GLuint program, Shading shading) { shadings[program] = shading; } // Программы без записи закрашиваются гладко.
+
+    std::string name() const override { return "software rasterizer (" + std::to_string(threadCount()) + " threads)"; }
+    bool usesCpuGeometry() const override { return true; }
+    void beginFrame(int w, int h) override {
+        if (w != width || h != height) {
+            width = std::max(w, 1); height = std::max(h, 1);
+            tilesX = (width + TileSize - 1) / TileSize; tilesY = (height + TileSize - 1) / TileSize;
+            colors.assign((size_t)width * height, clearColor);
+            depths.assign((size_t)width * height, 1.0f);
+            bins.assign((size_t)tilesX * tilesY, std::vector<uint32_t>());
+        }
+        clearPending = true;
+    }
+    void draw(const DrawCommand& c) override {
+        if (!c.mesh || c.mesh->vertices.empty() || c.instances != 1 || width == 0) { skippedCommands++; return; }
+        auto shading = shadings.find(c.program);
+        bool flat = shading != shadings.end() && shading->second == Shading::Flat;
+        // Диапазоны индексов: участки набора мультиотрисовки или вся команда.
+        struct Range { size_t first, count; GLint baseVertex; };
+        std::vector<Range> ranges;
+        if (c.batch) {
+            for (GLsizei i = 0; i < c.batch->drawCount && i < (GLsizei)c.batch->counts.size(); ++i)
+                ranges.push_back({ (size_t)c.batch->offsets[i] / indexSize(c.indexType), (size_t)c.batch->counts[i], c.batch->baseVertices[i] });
+        }
+        else ranges.push_back({ 0, (size_t)c.count, 0 });
+        const std::vector<InterleavedVertex>& vertices = c.mesh->vertices;
+        const std::vector<GLuint>& indices = c.mesh->indices;
+        transformed.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) transformed[i] = toWindow(vertices[i]); // Каждая вершина преобразуется один раз.
+        for (const Range& range : ranges) {
+            strip.clear();
+            for (size_t k = range.first; k < range.first + range.count; ++k) {
+                GLuint index = (GLuint)k;
+                if (c.indexType) {
+                    if (k >= indices.size()) break;
+                    index = indices[k];
+                    if (index == PRIMITIVE_RESTART_INDEX) { assemble(c.mode, flat, c.state); strip.clear(); continue; }
+                    index += range.baseVertex;
+                }
+                if (index >= vertices.size()) break;
+                strip.push_back(index);
+            }
+            assemble(c.mode, flat, c.state);
+        }
+    }
+    void finish() override {
+        if (primitives.empty() && !clearPending) return;
+        nextTile = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        rasterTiles();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return busy == 0; });
+        }
+        clearPending = false;
+        primitives.clear();
+        for (std::vector<uint32_t>& tileBin : bins) tileBin.clear();
+    }
+};
+
+// Общий программный растеризатор (потоки создаются при первом обращении).
+inline SoftwareRasterizer& softwareRasterizer() { static SoftwareRasterizer rasterizer; return rasterizer; }
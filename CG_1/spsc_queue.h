@@ -0,0 +1,30 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Очередь без блокировок для одного писателя и одного читателя фиксированной емкости Capacity (степень двойки).
+// push вызывается только из потока-писателя, pop - только из потока-читателя; при заполнении push возвращает false.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+private:
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> head{ 0 }; // Следующий элемент для чтения (меняет читатель).
+    alignas(64) std::atomic<size_t> tail{ 0 }; // Следующая свободная ячейка (меняет писатель).
+public:
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+};
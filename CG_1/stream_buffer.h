@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <chrono>
+
+#include <GL/glew.h>
+
+#include "gl_buffer.h"
+
+// Кольцевой буфер для вершин, которые заново формируются каждый кадр. Буфер разбит на Segments частей,
+// кадр пишет в свою часть, а перед повторным использованием части ждет fence, поставленный после ее отрисовки,
+// поэтому CPU не ждет GPU, пока тот отстает не больше чем на Segments - 1 кадр.
+// При поддержке GL 4.4 / ARB_buffer_storage память отображается постоянно (GL_MAP_PERSISTENT_BIT),
+// иначе буфер "сиротеет" (glBufferData с nullptr) в начале каждого круга и части отображаются без синхронизации.
+class StreamBuffer {
+public:
+    static const int Segments = 3;
+private:
+    GLBuffer buffer;
+    size_t segmentSize = 0; // Размер части буфера на один кадр.
+    size_t used = 0; // Занято байтов в части текущего кадра.
+    int segment = Segments - 1; // Часть текущего кадра.
+    GLsync fences[Segments] = {};
+    unsigned char* mapped = nullptr; // Постоянное отображение всего буфера (только при persistent).
+    bool persistent = false;
+    bool pendingUnmap = false; // Запасной путь: диапазон отображен и должен быть закрыт до отрисовки.
+public:
+    double waitSeconds = 0.0; // Суммарное время ожидания CPU на fence.
+    long waits = 0; // Сколько раз fence еще не был пройден и пришлось ждать.
+
+    StreamBuffer() = default;
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+    ~StreamBuffer() {
+        for (GLsync& fence : fences) if (fence) glDeleteSync(fence);
+        if (mapped) { buffer.bind(GL_ARRAY_BUFFER); glUnmapBuffer(GL_ARRAY_BUFFER); }
+    }
+
+    // Создание буфера, в который за кадр можно записать до bytesPerFrame байтов.
+    void create(size_t bytesPerFrame) {
+        segmentSize = bytesPerFrame;
+        persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+        if (persistent) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            buffer.allocateStorage(GL_ARRAY_BUFFER, segmentSize * Segments, flags);
+            mapped = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, segmentSize * Segments, flags));
+            persistent = mapped != nullptr;
+        }
+        if (!persistent) buffer.upload(GL_ARRAY_BUFFER, nullptr, segmentSize * Segments, GL_STREAM_DRAW);
+    }
+
+    // Переход к части следующего кадра. Если GPU еще читает ее, ждем fence (время копится в waitSeconds).
+    void beginFrame() {
+        segment = (segment + 1) % Segments;
+        used = 0;
+        GLsync& fence = fences[segment];
+        if (fence) {
+            GLenum status = glClientWaitSync(fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                auto start = std::chrono::steady_clock::now();
+                waits++;
+                while (status == GL_TIMEOUT_EXPIRED) status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                waitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (!persistent && segment == 0) { // Новый круг: отдаем старую память драйверу вместо ожидания.
+            buffer.bind(GL_ARRAY_BUFFER);
+            glBufferData(GL_ARRAY_BUFFER, segmentSize * Segments, nullptr, GL_STREAM_DRAW);
+        }
+    }
+    // Выделение size байтов в части текущего кадра. Возвращает адрес для записи (nullptr, если места нет),
+    // offset получает смещение от начала буфера. Перед отрисовкой нужно вызвать unmap().
+    void* allocate(size_t size, size_t& offset, size_t alignment = 64) {
+        size_t begin = (used + alignment - 1) / alignment * alignment;
+        if (begin + size > segmentSize) return nullptr;
+        unmap();
+        used = begin + size;
+        offset = segment * segmentSize + begin;
+        if (persistent) return mapped + offset;
+        buffer.bind(GL_ARRAY_BUFFER);
+        pendingUnmap = true;
+        return glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    }
+    void unmap() { // Закрытие отображения запасного пути (при постоянном отображении ничего не делает).
+        if (!pendingUnmap) return;
+        buffer.bind(GL_ARRAY_BUFFER);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        pendingUnmap = false;
+    }
+    // Вызывается после отправки всех отрисовок кадра: ставит fence для части текущего кадра.
+    void endFrame() {
+        if (persistent) fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    GLuint get() const { return buffer.get(); }
+    bool isPersistent() const { return persistent; }
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "draw_queue.h"
+#include "gl_buffer.h"
+#include "shader_cache.h"
+#include "vertex_format.h"
+
+// Номера атрибутов шейдера толстых линий из таблицы SHADER_ATTRIBUTES (привязываются до компоновки программы).
+constexpr GLuint LINE_ATTRIBUTE_PREV = shaderAttributeLocation("point_prev"), LINE_ATTRIBUTE_A = shaderAttributeLocation("point_a");
+constexpr GLuint LINE_ATTRIBUTE_B = shaderAttributeLocation("point_b"), LINE_ATTRIBUTE_NEXT = shaderAttributeLocation("point_next");
+constexpr GLuint LINE_ATTRIBUTE_COLOR_A = shaderAttributeLocation("color_a"), LINE_ATTRIBUTE_COLOR_B = shaderAttributeLocation("color_b");
+static_assert(LINE_ATTRIBUTE_PREV != NO_SHADER_ATTRIBUTE && LINE_ATTRIBUTE_A != NO_SHADER_ATTRIBUTE && LINE_ATTRIBUTE_B != NO_SHADER_ATTRIBUTE &&
+    LINE_ATTRIBUTE_NEXT != NO_SHADER_ATTRIBUTE && LINE_ATTRIBUTE_COLOR_A != NO_SHADER_ATTRIBUTE && LINE_ATTRIBUTE_COLOR_B != NO_SHADER_ATTRIBUTE,
+    "thick line attributes must be bound in SHADER_ATTRIBUTES");
+
+// Ломаная произвольной толщины, которая рисуется четырехугольниками вместо glLineWidth
+// (широкие линии устарели в core profile и во многих драйверах ограничены или медленны).
+// Каждый отрезок - экземпляр из 4 вершин GL_TRIANGLE_STRIP; концы отрезка и соседние точки для соединений
+// читаются из одного буфера атрибутами экземпляра со сдвигом на 0..3 вершины, а четырехугольник строит
+// вершинный шейдер (VERTEX_SHADER_THICK_LINE) по DrawState::lineWidth и DrawState::lineJoin.
+// Поэтому стоимость отрисовки не зависит от толщины, кроме числа закрашиваемых пикселей.
+class ThickPolyline {
+private:
+    GLVertexArray vao;
+    GLBuffer buffer; // Точки с дополнительной точкой в начале и в конце (соседи первого и последнего отрезков).
+    GLsizei segments = 0;
+    GLuint shaderProgramID = 0;
+    const char* name = "polyline";
+public:
+    // Загрузка точек ломаной. Для замкнутой (closed, как GL_LINE_LOOP) соседи берутся по кругу, для открытой
+    // (GL_LINE_STRIP) крайние точки повторяются: отрезок нулевой длины означает конец линии без соединения.
+    void load(const std::vector<glm::vec3>& points, const std::vector<glm::vec3>& colors, bool closed) {
+        size_t n = points.size();
+        segments = n < 2 ? 0 : (GLsizei)(closed ? n : n - 1);
+        std::vector<InterleavedVertex> data;
+        data.reserve(n + 3);
+        auto point = [&](size_t i) { return InterleavedVertex{ points[i], colors[i] }; };
+        if (n >= 2) {
+            data.push_back(point(closed ? n - 1 : 0));
+            for (size_t i = 0; i < n; ++i) data.push_back(point(i));
+            if (closed) { data.push_back(point(0)); data.push_back(point(1)); }
+            else data.push_back(point(n - 1));
+        }
+        vao.bind();
+        buffer.upload(GL_ARRAY_BUFFER, data.data(), data.size() * sizeof(InterleavedVertex));
+        const GLuint positions[] = { LINE_ATTRIBUTE_PREV, LINE_ATTRIBUTE_A, LINE_ATTRIBUTE_B, LINE_ATTRIBUTE_NEXT };
+        for (size_t k = 0; k < 4; ++k) {
+            glVertexAttribPointer(positions[k], 3, GL_FLOAT, GL_FALSE, sizeof(InterleavedVertex), (void*)(k * sizeof(InterleavedVertex) + offsetof(InterleavedVertex, position)));
+            glVertexAttribDivisor(positions[k], 1);
+            glEnableVertexAttribArray(positions[k]);
+        }
+        for (size_t k = 0; k < 2; ++k) {
+            GLuint attribute = k == 0 ? LINE_ATTRIBUTE_COLOR_A : LINE_ATTRIBUTE_COLOR_B;
+            glVertexAttribPointer(attribute, 3, GL_FLOAT, GL_FALSE, sizeof(InterleavedVertex), (void*)((k + 1) * sizeof(InterleavedVertex) + offsetof(InterleavedVertex, color)));
+            glVertexAttribDivisor(attribute, 1);
+            glEnableVertexAttribArray(attribute);
+        }
+    }
+    // Отрисовка всех отрезков одним вызовом с толщиной и соединениями из текущего drawQueue().state.
+    void render() {
+        if (segments > 0) drawQueue().push(shaderProgramID, vao.get(), GL_TRIANGLE_STRIP, 4, 0, segments, name);
+    }
+    GLsizei segment_count() const { return segments; }
+    void setShaderProgram(GLuint programID) { shaderProgramID = programID; } // Программа из VERTEX_SHADER_THICK_LINE.
+    void setName(const char* lineName) { name = lineName; }
+};
@@ -0,0 +1,427 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "index_buffer.h"
+
+// Триангуляция многоугольников отсечением ушей. Контур может быть невыпуклым и содержать дыры.
+// Вершины хранятся в двусвязном списке; для больших контуров (больше 80 вершин) вершины дополнительно
+// связаны в порядке Z-кривой, и проверка уха просматривает только вершины из ограничивающего прямоугольника
+// треугольника, что дает близкое к O(n log n) время. Если уши закончились (самопересечения),
+// выполняются проходы с удалением вырожденных вершин, исправлением локальных пересечений и разбиением по диагонали.
+// Треугольники выдаются против часовой стрелки.
+class Triangulator {
+private:
+    struct Node {
+        GLuint i; // Индекс вершины во входном массиве.
+        float x, y;
+        Node* prev = nullptr, * next = nullptr; // Соседи по контуру.
+        uint32_t z = 0; bool zSet = false; // Код Z-кривой.
+        Node* prevZ = nullptr, * nextZ = nullptr; // Соседи в порядке Z-кривой.
+        bool steiner = false; // Дыра из одной точки.
+    };
+    std::deque<Node> nodes; // deque не перемещает узлы при добавлении.
+    std::vector<GLuint>* triangles = nullptr;
+    float minX = 0.0f, minY = 0.0f, invSize = 0.0f;
+    bool hashed = false;
+
+    Node* insertNode(GLuint i, const glm::vec2& point, Node* last) {
+        nodes.push_back(Node{ i, point.x, point.y });
+        Node* p = &nodes.back();
+        if (!last) { p->prev = p; p->next = p; }
+        else { p->next = last->next; p->prev = last; last->next->prev = p; last->next = p; }
+        return p;
+    }
+    static void removeNode(Node* p) {
+        p->next->prev = p->prev; p->prev->next = p->next;
+        if (p->prevZ) p->prevZ->nextZ = p->nextZ;
+        if (p->nextZ) p->nextZ->prevZ = p->prevZ;
+    }
+    static float area(const Node* p, const Node* q, const Node* r) { // Меньше нуля - поворот против часовой стрелки.
+        return (q->y - p->y) * (r->x - q->x) - (q->x - p->x) * (r->y - q->y);
+    }
+    static bool equals(const Node* a, const Node* b) { return a->x == b->x && a->y == b->y; }
+    static bool pointInTriangle(float ax, float ay, float bx, float by, float cx, float cy, float px, float py) {
+        return (cx - px) * (ay - py) >= (ax - px) * (cy - py) && (ax - px) * (by - py) >= (bx - px) * (ay - py) && (bx - px) * (cy - py) >= (cx - px) * (by - py);
+    }
+    static int sign(float v) { return (v > 0.0f) - (v < 0.0f); }
+    static bool onSegment(const Node* p, const Node* q, const Node* r) {
+        return q->x <= std::max(p->x, r->x) && q->x >= std::min(p->x, r->x) && q->y <= std::max(p->y, r->y) && q->y >= std::min(p->y, r->y);
+    }
+    static bool intersects(const Node* p1, const Node* q1, const Node* p2, const Node* q2) {
+        int o1 = sign(area(p1, q1, p2)), o2 = sign(area(p1, q1, q2)), o3 = sign(area(p2, q2, p1)), o4 = sign(area(p2, q2, q1));
+        if (o1 != o2 && o3 != o4) return true;
+        return (o1 == 0 && onSegment(p1, p2, q1)) || (o2 == 0 && onSegment(p1, q2, q1)) || (o3 == 0 && onSegment(p2, p1, q2)) || (o4 == 0 && onSegment(p2, q1, q2));
+    }
+    static bool intersectsPolygon(const Node* a, const Node* b) { // Пересекает ли отрезок a-b какое-либо ребро контура.
+        const Node* p = a;
+        do {
+            if (p->i != a->i && p->next->i != a->i && p->i != b->i && p->next->i != b->i && intersects(p, p->next, a, b)) return true;
+            p = p->next;
+        } while (p != a);
+        return false;
+    }
+    static bool locallyInside(const Node* a, const Node* b) { // Лежит ли диагональ a-b внутри угла при вершине a.
+        return area(a->prev, a, a->next) < 0 ? area(a, b, a->next) >= 0 && area(a, a->prev, b) >= 0 : area(a, b, a->prev) < 0 || area(a, a->next, b) < 0;
+    }
+    static bool middleInside(const Node* a, const Node* b) { // Лежит ли середина a-b внутри контура (четность пересечений луча).
+        const Node* p = a;
+        bool inside = false;
+        float px = (a->x + b->x) / 2, py = (a->y + b->y) / 2;
+        do {
+            if (((p->y > py) != (p->next->y > py)) && p->next->y != p->y && (px < (p->next->x - p->x) * (py - p->y) / (p->next->y - p->y) + p->x)) inside = !inside;
+            p = p->next;
+        } while (p != a);
+        return inside;
+    }
+    static bool isValidDiagonal(const Node* a, const Node* b) {
+        return a->next->i != b->i && a->prev->i != b->i && !intersectsPolygon(a, b) &&
+            ((locallyInside(a, b) && locallyInside(b, a) && middleInside(a, b) && (area(a->prev, a, b->prev) != 0 || area(a, b->prev, b) != 0)) ||
+             (equals(a, b) && area(a->prev, a, a->next) > 0 && area(b->prev, b, b->next) > 0));
+    }
+    static bool sectorContainsSector(const Node* m, const Node* p) { return area(m->prev, m, p->prev) < 0 && area(p->next, m, m->next) < 0; }
+
+    // Разрезает контур диагональю a-b на два, возвращает копию b во втором контуре.
+    Node* splitPolygon(Node* a, Node* b) {
+        nodes.push_back(Node{ a->i, a->x, a->y });
+        Node* a2 = &nodes.back();
+        nodes.push_back(Node{ b->i, b->x, b->y });
+        Node* b2 = &nodes.back();
+        Node* an = a->next, * bp = b->prev;
+        a->next = b; b->prev = a;
+        a2->next = an; an->prev = a2;
+        b2->next = a2; a2->prev = b2;
+        bp->next = b2; b2->prev = bp;
+        return b2;
+    }
+    Node* linkedList(const std::vector<glm::vec2>& points, size_t start, size_t end, bool counterClockwise) {
+        double sum = 0.0; // Удвоенная ориентированная площадь (больше нуля - против часовой стрелки).
+        for (size_t i = start, j = end - 1; i < end; j = i++) sum += (double)(points[j].x - points[i].x) * (points[i].y + points[j].y);
+        Node* last = nullptr;
+        if (counterClockwise == (sum > 0)) for (size_t i = start; i < end; ++i) last = insertNode((GLuint)i, points[i], last);
+        else for (size_t i = end; i-- > start;) last = insertNode((GLuint)i, points[i], last);
+        if (last && equals(last, last->next)) { Node* next = last->next; removeNode(last); last = next; }
+        return last;
+    }
+    static Node* filterPoints(Node* start, Node* end = nullptr) { // Удаление совпадающих и лежащих на одной прямой вершин.
+        if (!start) return start;
+        if (!end) end = start;
+        Node* p = start;
+        bool again;
+        do {
+            again = false;
+            if (!p->steiner && (equals(p, p->next) || area(p->prev, p, p->next) == 0)) {
+                removeNode(p);
+                p = end = p->prev;
+                if (p == p->next) break;
+                again = true;
+            }
+            else p = p->next;
+        } while (again || p != end);
+        return end;
+    }
+
+    uint32_t zOrder(float px, float py) const {
+        uint32_t x = (uint32_t)((px - minX) * invSize), y = (uint32_t)((py - minY) * invSize);
+        x = (x | (x << 8)) & 0x00FF00FF; x = (x | (x << 4)) & 0x0F0F0F0F; x = (x | (x << 2)) & 0x33333333; x = (x | (x << 1)) & 0x55555555;
+        y = (y | (y << 8)) & 0x00FF00FF; y = (y | (y << 4)) & 0x0F0F0F0F; y = (y | (y << 2)) & 0x33333333; y = (y | (y << 1)) & 0x55555555;
+        return x | (y << 1);
+    }
+    void indexCurve(Node* start) { // Связывание вершин в порядке Z-кривой.
+        Node* p = start;
+        do {
+            if (!p->zSet) { p->z = zOrder(p->x, p->y); p->zSet = true; }
+            p->prevZ = p->prev; p->nextZ = p->next;
+            p = p->next;
+        } while (p != start);
+        p->prevZ->nextZ = nullptr;
+        p->prevZ = nullptr;
+        sortLinked(p);
+    }
+    static Node* sortLinked(Node* list) { // Сортировка слиянием списка по z (без дополнительной памяти).
+        int inSize = 1, merges;
+        do {
+            Node* p = list, * tail = nullptr;
+            list = nullptr; merges = 0;
+            while (p) {
+                merges++;
+                Node* q = p;
+                int pSize = 0;
+                for (int i = 0; i < inSize && q; ++i) { pSize++; q = q->nextZ; }
+                int qSize = inSize;
+                while (pSize > 0 || (qSize > 0 && q)) {
+                    Node* e;
+                    if (pSize != 0 && (qSize == 0 || !q || p->z <= q->z)) { e = p; p = p->nextZ; pSize--; }
+                    else { e = q; q = q->nextZ; qSize--; }
+                    if (tail) tail->nextZ = e; else list = e;
+                    e->prevZ = tail;
+                    tail = e;
+                }
+                p = q;
+            }
+            tail->nextZ = nullptr;
+            inSize *= 2;
+        } while (merges > 1);
+        return list;
+    }
+
+    bool isEar(const Node* ear) const {
+        const Node* a = ear->prev, * b = ear, * c = ear->next;
+        if (area(a, b, c) >= 0) return false; // Вогнутая вершина не может быть ухом.
+        for (const Node* p = c->next; p != a; p = p->next)
+            if (pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) && area(p->prev, p, p->next) >= 0) return false;
+        return true;
+    }
+    bool isEarHashed(const Node* ear) const {
+        const Node* a = ear->prev, * b = ear, * c = ear->next;
+        if (area(a, b, c) >= 0) return false;
+        uint32_t minZ = zOrder(std::min({ a->x, b->x, c->x }), std::min({ a->y, b->y, c->y }));
+        uint32_t maxZ = zOrder(std::max({ a->x, b->x, c->x }), std::max({ a->y, b->y, c->y }));
+        auto blocks = [&](const Node* p) {
+            return p != a && p != c && pointInTriangle(a->x, a->y, b->x, b->y, c->x, c->y, p->x, p->y) && area(p->prev, p, p->next) >= 0;
+        };
+        const Node* p = ear->prevZ, * n = ear->nextZ;
+        while (p && p->z >= minZ && n && n->z <= maxZ) { // Просмотр в обе стороны от уха по Z-кривой.
+            if (blocks(p)) return false;
+            p = p->prevZ;
+            if (blocks(n)) return false;
+            n = n->nextZ;
+        }
+        for (; p && p->z >= minZ; p = p->prevZ) if (blocks(p)) return false;
+        for (; n && n->z <= maxZ; n = n->nextZ) if (blocks(n)) return false;
+        return true;
+    }
+    void emit(const Node* a, const Node* b, const Node* c) { triangles->push_back(a->i); triangles->push_back(b->i); triangles->push_back(c->i); }
+    Node* cureLocalIntersections(Node* start) {
+        Node* p = start;
+        do {
+            Node* a = p->prev, * b = p->next->next;
+            if (!equals(a, b) && intersects(a, p, p->next, b) && locallyInside(a, b) && locallyInside(b, a)) {
+                emit(a, p, b);
+                removeNode(p); removeNode(p->next);
+                p = start = b;
+            }
+            p = p->next;
+        } while (p != start);
+        return filterPoints(p);
+    }
+    void splitEarcut(Node* start) {
+        Node* a = start;
+        do {
+            for (Node* b = a->next->next; b != a->prev; b = b->next) {
+                if (a->i != b->i && isValidDiagonal(a, b)) {
+                    Node* c = splitPolygon(a, b);
+                    a = filterPoints(a, a->next);
+                    c = filterPoints(c, c->next);
+                    earcutLinked(a, 0);
+                    earcutLinked(c, 0);
+                    return;
+                }
+            }
+            a = a->next;
+        } while (a != start);
+    }
+    void earcutLinked(Node* ear, int pass) {
+        if (!ear) return;
+        if (pass == 0 && hashed) indexCurve(ear);
+        Node* stop = ear;
+        while (ear->prev != ear->next) {
+            Node* prev = ear->prev, * next = ear->next;
+            if (hashed ? isEarHashed(ear) : isEar(ear)) {
+                emit(prev, ear, next);
+                removeNode(ear);
+                ear = stop = next->next;
+                continue;
+            }
+            ear = next;
+            if (ear == stop) { // Ушей не осталось: следующий проход.
+                if (pass == 0) earcutLinked(filterPoints(ear), 1);
+                else if (pass == 1) earcutLinked(cureLocalIntersections(filterPoints(ear)), 2);
+                else splitEarcut(ear);
+                break;
+            }
+        }
+    }
+
+    static Node* leftmost(Node* start) {
+        Node* p = start, * result = start;
+        do {
+            if (p->x < result->x || (p->x == result->x && p->y < result->y)) result = p;
+            p = p->next;
+        } while (p != start);
+        return result;
+    }
+    // Поиск вершины внешнего контура, которую можно соединить мостом с самой левой вершиной дыры.
+    static Node* findHoleBridge(Node* hole, Node* outerNode) {
+        Node* p = outerNode, * m = nullptr;
+        float hx = hole->x, hy = hole->y, qx = -std::numeric_limits<float>::infinity();
+        do { // Ближайшее ребро, которое пересекает луч из вершины дыры влево.
+            if (hy <= p->y && hy >= p->next->y && p->next->y != p->y) {
+                float x = p->x + (hy - p->y) * (p->next->x - p->x) / (p->next->y - p->y);
+                if (x <= hx && x > qx) {
+                    qx = x;
+                    m = p->x < p->next->x ? p : p->next;
+                    if (x == hx) return m; // Дыра касается ребра.
+                }
+            }
+            p = p->next;
+        } while (p != outerNode);
+        if (!m) return nullptr;
+        // Вершины внутри треугольника (дыра, пересечение, m) могут загораживать m: берем из них ближайшую по углу.
+        Node* stop = m;
+        float mx = m->x, my = m->y, tanMin = std::numeric_limits<float>::infinity();
+        p = m;
+        do {
+            if (hx >= p->x && p->x >= mx && hx != p->x &&
+                pointInTriangle(hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y)) {
+                float tan = std::abs(hy - p->y) / (hx - p->x);
+                if (locallyInside(p, hole) && (tan < tanMin || (tan == tanMin && (p->x > m->x || (p->x == m->x && sectorContainsSector(m, p)))))) {
+                    m = p; tanMin = tan;
+                }
+            }
+            p = p->next;
+        } while (p != stop);
+        return m;
+    }
+    Node* eliminateHoles(const std::vector<glm::vec2>& points, const std::vector<size_t>& holeStarts, Node* outerNode) {
+        std::vector<Node*> queue;
+        for (size_t h = 0; h < holeStarts.size(); ++h) {
+            size_t start = holeStarts[h], end = h + 1 < holeStarts.size() ? holeStarts[h + 1] : points.size();
+            Node* list = linkedList(points, start, end, false);
+            if (!list) continue;
+            if (list == list->next) list->steiner = true;
+            queue.push_back(leftmost(list));
+        }
+        std::sort(queue.begin(), queue.end(), [](const Node* a, const Node* b) { return a->x < b->x || (a->x == b->x && a->y < b->y); });
+        for (Node* hole : queue) { // Дыры присоединяются к внешнему контуру мостами слева направо.
+            Node* bridge = findHoleBridge(hole, outerNode);
+            if (!bridge) continue;
+            Node* bridgeReverse = splitPolygon(bridge, hole);
+            filterPoints(bridgeReverse, bridgeReverse->next);
+            outerNode = filterPoints(bridge, bridge->next);
+        }
+        return outerNode;
+    }
+public:
+    // Триангуляция контура points[0, holeStarts[0]) с дырами points[holeStarts[k], holeStarts[k + 1]).
+    // Индексы треугольников дописываются в out, возвращается количество треугольников.
+    size_t triangulate(const std::vector<glm::vec2>& points, const std::vector<size_t>& holeStarts, std::vector<GLuint>& out) {
+        nodes.clear();
+        triangles = &out;
+        size_t before = out.size();
+        size_t outerEnd = holeStarts.empty() ? points.size() : holeStarts[0];
+        Node* outer = outerEnd >= 3 ? linkedList(points, 0, outerEnd, true) : nullptr;
+        if (!outer || outer->next == outer->prev) return 0;
+        if (!holeStarts.empty()) outer = eliminateHoles(points, holeStarts, outer);
+        hashed = points.size() > 80;
+        if (hashed) { // Масштаб для кодов Z-кривой по ограничивающему прямоугольнику внешнего контура.
+            float maxX = minX = points[0].x, maxY = minY = points[0].y;
+            for (size_t i = 1; i < outerEnd; ++i) {
+                minX = std::min(minX, points[i].x); minY = std::min(minY, points[i].y);
+                maxX = std::max(maxX, points[i].x); maxY = std::max(maxY, points[i].y);
+            }
+            float size = std::max(maxX - minX, maxY - minY);
+            invSize = size != 0.0f ? 32767.0f / size : 0.0f;
+        }
+        earcutLinked(outer, 0);
+        nodes.clear();
+        return (out.size() - before) / 3;
+    }
+};
+
+// Функция триангулирует простой (возможно невыпуклый) контур без дыр, заданный вершинами по порядку (z не учитывается).
+inline std::vector<GLuint> triangulatePolygon(const std::vector<glm::vec3>& outline) {
+    std::vector<glm::vec2> points(outline.size());
+    for (size_t i = 0; i < outline.size(); ++i) points[i] = glm::vec2(outline[i]);
+    std::vector<GLuint> indices;
+    Triangulator().triangulate(points, {}, indices);
+    return indices;
+}
+
+// Функция собирает из списка треугольников полосы (GL_TRIANGLE_STRIP), разделенные PRIMITIVE_RESTART_INDEX.
+// Полоса продолжается, пока есть неиспользованный соседний треугольник с подходящим направлением обхода,
+// поэтому ориентация всех треугольников сохраняется.
+inline std::vector<GLuint> trianglesToStrips(const std::vector<GLuint>& triangles) {
+    size_t count = triangles.size() / 3;
+    auto edgeKey = [](GLuint a, GLuint b) { return (uint64_t)a << 32 | b; };
+    std::unordered_map<uint64_t, size_t> edges; // Направленное ребро -> треугольник, в обходе которого оно есть.
+    for (size_t t = 0; t < count; ++t)
+        for (int k = 0; k < 3; ++k) edges[edgeKey(triangles[3 * t + k], triangles[3 * t + (k + 1) % 3])] = t;
+    std::vector<bool> used(count, false);
+    std::vector<GLuint> strips;
+    for (size_t t = 0; t < count; ++t) {
+        if (used[t]) continue;
+        used[t] = true;
+        if (!strips.empty()) strips.push_back(PRIMITIVE_RESTART_INDEX);
+        size_t stripStart = strips.size();
+        int first = 0; // Начинаем с того поворота треугольника, у которого есть сосед для продолжения полосы.
+        for (int k = 0; k < 3; ++k) {
+            auto it = edges.find(edgeKey(triangles[3 * t + (k + 2) % 3], triangles[3 * t + (k + 1) % 3]));
+            if (it != edges.end() && !used[it->second]) { first = k; break; }
+        }
+        strips.insert(strips.end(), { triangles[3 * t + first], triangles[3 * t + (first + 1) % 3], triangles[3 * t + (first + 2) % 3] });
+        for (;;) {
+            size_t n = strips.size() - stripStart;
+            GLuint x = strips[strips.size() - 2], y = strips.back();
+            // Треугольник номер n - 2 полосы обходится как (x, y, z) при четном номере и (y, x, z) при нечетном.
+            auto it = (n % 2 == 0) ? edges.find(edgeKey(x, y)) : edges.find(edgeKey(y, x));
+            if (it == edges.end() || used[it->second]) break;
+            size_t next = it->second;
+            GLuint z = 0;
+            for (int k = 0; k < 3; ++k) { GLuint v = triangles[3 * next + k]; if (v != x && v != y) z = v; }
+            used[next] = true;
+            strips.push_back(z);
+        }
+    }
+    return strips;
+}
+
+// Функция собирает из списка треугольников вееры (GL_TRIANGLE_FAN). Центром очередного веера выбирается вершина
+// с наибольшим числом еще не вошедших в вееры треугольников, а веер идет по соседним треугольникам вокруг нее
+// в направлении их обхода, поэтому ориентация треугольников сохраняется.
+inline std::vector<std::vector<GLuint>> trianglesToFans(const std::vector<GLuint>& triangles) {
+    size_t count = triangles.size() / 3, left = count;
+    std::vector<bool> used(count, false);
+    std::vector<std::vector<GLuint>> fans;
+    while (left > 0) {
+        std::unordered_map<GLuint, size_t> degree;
+        for (size_t t = 0; t < count; ++t)
+            if (!used[t]) for (int k = 0; k < 3; ++k) degree[triangles[3 * t + k]]++;
+        GLuint center = 0;
+        size_t best = 0;
+        for (size_t i = 0; i < 3 * count; ++i) // Первая в порядке списка вершина с наибольшим числом треугольников.
+            if (!used[i / 3] && degree[triangles[i]] > best) { best = degree[triangles[i]]; center = triangles[i]; }
+        // Треугольник (center, a, b) продолжает веер, последняя вершина которого a.
+        std::unordered_map<GLuint, std::pair<size_t, GLuint>> around;
+        std::unordered_map<GLuint, bool> isEnd;
+        std::vector<GLuint> starts;
+        for (size_t t = 0; t < count; ++t) {
+            if (used[t]) continue;
+            for (int k = 0; k < 3; ++k) {
+                if (triangles[3 * t + k] != center) continue;
+                GLuint a = triangles[3 * t + (k + 1) % 3], b = triangles[3 * t + (k + 2) % 3];
+                around[a] = { t, b };
+                isEnd[b] = true;
+                starts.push_back(a);
+            }
+        }
+        GLuint start = starts[0]; // Веер начинается с ребра, перед которым нет треугольника (у замкнутого - с любого).
+        for (GLuint a : starts) if (!isEnd.count(a)) { start = a; break; }
+        std::vector<GLuint> fan = { center, start };
+        for (auto it = around.find(start); it != around.end() && !used[it->second.first]; it = around.find(fan.back())) {
+            used[it->second.first] = true;
+            left--;
+            fan.push_back(it->second.second);
+        }
+        fans.push_back(fan);
+    }
+    return fans;
+}
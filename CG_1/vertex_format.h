@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+// Перечисление для способа размещения атрибутов вершин в видеопамяти.
+// Сжатые форматы (от HalfRGBA8) хранят позицию 16-битными числами, а цвет - в 32 битах (CompactVertex).
+enum class VertexLayout { Split = 1, Interleaved, Packed, HalfRGBA8, HalfRGB10A2, Snorm16RGBA8, Snorm16RGB10A2 };
+
+// Вершина в чередующемся формате: позиция и цвет подряд в одном буфере (24 байта).
+struct InterleavedVertex { glm::vec3 position; glm::vec3 color; };
+// Вершина в упакованном формате: цвет хранится нормализованными байтами RGBA (16 байт).
+struct PackedVertex { glm::vec3 position; glm::uint color; };
+
+// Сжатая вершина (12 байт): позиция 4 x 16 бит (GL_HALF_FLOAT или нормализованные GL_SHORT, w не используется)
+// и цвет RGBA8 или GL_UNSIGNED_INT_2_10_10_10_REV. Позиция хранится двумя 32-битными словами, чтобы структура
+// выравнивалась по 4 байтам и не дополнялась до 16.
+struct CompactVertex { glm::uint position[2]; glm::uint color; };
+
+// Преобразование сжатой позиции обратно в координаты: p = stored * scale + offset (выполняет вершинный шейдер).
+struct PositionTransform {
+    glm::vec3 scale = glm::vec3(1.0f);
+    glm::vec3 offset = glm::vec3(0.0f);
+};
+
+inline bool isCompactLayout(VertexLayout layout) { return layout >= VertexLayout::HalfRGBA8; }
+inline bool hasHalfPositions(VertexLayout layout) { return layout == VertexLayout::HalfRGBA8 || layout == VertexLayout::HalfRGB10A2; }
+inline bool hasRGB10A2Colors(VertexLayout layout) { return layout == VertexLayout::HalfRGB10A2 || layout == VertexLayout::Snorm16RGB10A2; }
+
+// Функция возвращает преобразование, переводящее ограничивающий параллелепипед позиций в куб [-1, 1]:
+// в этом диапазоне snorm16 использует все значения, а у half наибольшая точность.
+inline PositionTransform quantizationTransform(const std::vector<glm::vec3>& positions) {
+    PositionTransform transform;
+    if (positions.empty()) return transform;
+    glm::vec3 low = positions[0], high = positions[0];
+    for (const glm::vec3& p : positions) { low = glm::min(low, p); high = glm::max(high, p); }
+    transform.offset = (low + high) * 0.5f;
+    transform.scale = (high - low) * 0.5f;
+    for (int axis = 0; axis < 3; ++axis) if (transform.scale[axis] <= 0.0f) transform.scale[axis] = 1.0f; // Плоская ось (z = 0 у фигур заданий).
+    return transform;
+}
+
+// Функция упаковывает позиции и цвета в сжатый формат layout. Упаковка идет целыми vec4 функциями
+// glm/gtc/packing.hpp (packHalf4x16, packSnorm4x16, packUnorm4x8, packUnorm3x10_1x2), по одному вызову на атрибут вершины.
+inline void packCompactVertices(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& colors, VertexLayout layout,
+    const PositionTransform& transform, CompactVertex* out) {
+    bool half = hasHalfPositions(layout), rgb10 = hasRGB10A2Colors(layout);
+    glm::vec3 inverseScale = 1.0f / transform.scale;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        glm::vec4 p(glm::clamp((positions[i] - transform.offset) * inverseScale, -1.0f, 1.0f), 1.0f);
+        glm::uint64 position = half ? glm::packHalf4x16(p) : glm::packSnorm4x16(p);
+        memcpy(out[i].position, &position, sizeof(position));
+        glm::vec4 c(colors[i], 1.0f);
+        out[i].color = rgb10 ? glm::packUnorm3x10_1x2(c) : glm::packUnorm4x8(c);
+    }
+}
+
+// Функция восстанавливает позицию из сжатой вершины (для оценки ошибки квантования).
+inline glm::vec3 unpackCompactPosition(const CompactVertex& vertex, VertexLayout layout, const PositionTransform& transform) {
+    glm::uint64 position;
+    memcpy(&position, vertex.position, sizeof(position));
+    glm::vec4 p = hasHalfPositions(layout) ? glm::unpackHalf4x16(position) : glm::unpackSnorm4x16(position);
+    return glm::vec3(p) * transform.scale + transform.offset;
+}
+
+// Имена форматов для командной строки (--layout) и вывода замеров.
+inline const char* vertexLayoutName(VertexLayout layout) {
+    static const char* names[] = { "split", "interleaved", "packed", "half", "half-rgb10a2", "snorm16", "snorm16-rgb10a2" };
+    return names[(int)layout - 1];
+}
+inline bool vertexLayoutFromName(const char* name, VertexLayout& layout) {
+    for (int i = (int)VertexLayout::Split; i <= (int)VertexLayout::Snorm16RGB10A2; ++i)
+        if (strcmp(name, vertexLayoutName((VertexLayout)i)) == 0) { layout = (VertexLayout)i; return true; }
+    return false;
+}
+
+// Размер одной вершины в буфере формата layout (для Split - только позиция, цвета лежат во втором буфере).
+inline size_t vertexStride(VertexLayout layout) {
+    if (isCompactLayout(layout)) return sizeof(CompactVertex);
+    if (layout == VertexLayout::Interleaved) return sizeof(InterleavedVertex);
+    if (layout == VertexLayout::Packed) return sizeof(PackedVertex);
+    return sizeof(glm::vec3);
+}
+
+// Функция записывает вершины в формате layout (кроме Split) в out размером positions.size() * vertexStride(layout) байт.
+// transform используется только сжатыми форматами (quantizationTransform).
+inline void packVertices(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& colors, VertexLayout layout,
+    const PositionTransform& transform, void* out) {
+    if (isCompactLayout(layout)) { packCompactVertices(positions, colors, layout, transform, static_cast<CompactVertex*>(out)); return; }
+    if (layout == VertexLayout::Packed) {
+        PackedVertex* vertex = static_cast<PackedVertex*>(out);
+        for (size_t i = 0; i < positions.size(); ++i) vertex[i] = { positions[i], glm::packUnorm4x8(glm::vec4(colors[i], 1.0f)) };
+        return;
+    }
+    InterleavedVertex* vertex = static_cast<InterleavedVertex*>(out);
+    for (size_t i = 0; i < positions.size(); ++i) vertex[i] = { positions[i], colors[i] };
+}
+
+// Функция восстанавливает позицию и цвет вершины формата layout (кроме Split) по ее байтам в буфере.
+inline InterleavedVertex unpackVertex(const void* data, VertexLayout layout, const PositionTransform& transform) {
+    if (isCompactLayout(layout)) {
+        CompactVertex vertex;
+        memcpy(&vertex, data, sizeof(vertex));
+        glm::vec4 c = hasRGB10A2Colors(layout) ? glm::unpackUnorm3x10_1x2(vertex.color) : glm::unpackUnorm4x8(vertex.color);
+        return { unpackCompactPosition(vertex, layout, transform), glm::vec3(c) };
+    }
+    if (layout == VertexLayout::Packed) {
+        PackedVertex vertex;
+        memcpy(&vertex, data, sizeof(vertex));
+        return { vertex.position, glm::vec3(glm::unpackUnorm4x8(vertex.color)) };
+    }
+    InterleavedVertex vertex;
+    memcpy(&vertex, data, sizeof(vertex));
+    return vertex;
+}
+
+// Данные одного экземпляра для инстансинга: смещение, масштаб и цвет (множитель цвета вершин).
+struct InstanceData { glm::vec3 offset; float scale; glm::vec3 color; };